@@ -9,6 +9,7 @@
 #include "utils/tree_extension.hpp"
 #include "utils/extension.hpp"
 #include "utils/scanwidth.hpp"
+#include "utils/scanwidth_heuristic.hpp"
 
 using namespace PT;
  
@@ -47,6 +48,7 @@ void parse_options(const int argc, const char** argv)
   description["-pp"] = {0,0};
   description["-lm"] = {0,0};
   description["-m"] = {1,1};
+  description["-t"] = {1,1};
   description[""] = {1,1};
   const std::string help_message(std::string(argv[0]) + " <file>\n\
       \tcompute the scanwidth (+extension and/or extension tree) of the network described in file (extended newick or edgelist format)\n\
@@ -60,8 +62,11 @@ void parse_options(const int argc, const char** argv)
       \t\t\tx = 1: dynamic programming on all vertices,\n\
       \t\t\tx = 2: brute force on raising vertices only,\n\
       \t\t\tx = 3: dynamic programming on raising vertices only,\n\
-      \t\t\tx = 4: heuristic\n\
-      \t-pp\tuse preprocessing\n");
+      \t\t\tx = 4: heuristic (fast, prints the width of the extension it finds and the time taken),\n\
+      \t\t\tx = 5: branch and bound (dynamic programming on raising vertices, pruned by the widths found by the heuristic)\n\
+      \t-pp\tuse preprocessing\n\
+      \t-t x\trun the dynamic programming with x threads: solve the biconnected components concurrently (largest first) and, for each of them,\n\
+      \t\tgo through the node-sets by size, treating all node-sets of the same size in parallel\n");
 
   parse_options(argc, argv, description, help_message, options);
 
@@ -70,19 +75,25 @@ void parse_options(const int argc, const char** argv)
       std::cerr << filename << " cannot be opened for reading" << std::endl;
       exit(EXIT_FAILURE);
     }
+  if(test(options, "-t") && (stoi(options.at("-t")[0]) < 1)) {
+    std::cerr << "cannot run with "<<options.at("-t")[0]<<" threads\n";
+    exit(EXIT_FAILURE);
+  }
 }
 
 unsigned parse_method()
 {
+  // default method is 3
+  if(!test(options, "-m")) return 3;
   try{
     const unsigned method = std::stoi(options["-m"][0]);
-    if(method > 4){
+    if(method > 5){
       std::cout << method << " is not a vlid method, check help screen for valid methods" <<std::endl;
       exit(1);
     } else return method;
   } catch (const std::invalid_argument& ia) {
     // -m with non-integer argument
-    std::cout << "-m expects an integer argument from 0 to 4" <<std::endl;
+    std::cout << "-m expects an integer argument from 0 to 5" <<std::endl;
     exit(1);
   } catch (...) {
     // default method is 3
@@ -90,6 +101,11 @@ unsigned parse_method()
   } 
 }
 
+double ms_since(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 void print_extension(const MyNetwork& N, const Extension& ex)
 {
   using GammaType = CompatibleROTree<const MyNetwork>;
@@ -138,6 +154,38 @@ int main(const int argc, const char** argv)
 
 //  if(contains(options, "-pp") sw_preprocess(N);
 
+  if(parse_method() == 4){
+    std::cout << "\n ==== computing heuristic extension ===\n";
+    Extension ex_heu;
+    const auto start = std::chrono::steady_clock::now();
+    const sw_t width = compute_heuristic_sw_extension(N, ex_heu);
+    const double time = ms_since(start);
+    if(test(options, "-e"))
+      std::cout << "heuristic extension: " << ex_heu << std::endl;
+    // double check the width
+    assert(ex_heu.scanwidth(N) == width);
+    std::cout << "heuristic scanwidth: " << width << " (" << N.num_nodes() << " nodes, " << time << "ms)" << std::endl;
+    return 0;
+  }
+
+  if(parse_method() == 5){
+    std::cout << "\n ==== computing optimal extension by branch and bound ===\n";
+    Extension ex_bnb;
+    ScanwidthBranchAndBound<MyNetwork> bnb(N);
+    const auto start = std::chrono::steady_clock::now();
+    const sw_t width = bnb.compute_min_extension(ex_bnb);
+    const double time = ms_since(start);
+    if(test(options, "-e"))
+      std::cout << "extension: " << ex_bnb << std::endl;
+    assert(ex_bnb.scanwidth(N) == width);
+    if(bnb.get_lower_bound() == width)
+      std::cout << "scanwidth: " << width;
+    else
+      std::cout << "scanwidth: between " << bnb.get_lower_bound() << " and " << width;
+    std::cout << " (" << N.num_nodes() << " nodes, " << bnb.get_num_pruned() << " node sets pruned, " << time << "ms)" << std::endl;
+    return 0;
+  }
+
   std::cout << "\n ==== computing silly post-order extension ===\n";
   
   //const Extension ex(N.dfs().postorder());
@@ -151,10 +199,11 @@ int main(const int argc, const char** argv)
   std::cout << "\n ==== computing optimal extension ===\n";
 
   Extension ex_opt;
+  const size_t num_threads = test(options, "-t") ? std::stoi(options["-t"][0]) : 1;
   if(test(options, "-lm"))
-    compute_min_sw_extension<true>(N, ex_opt);
+    compute_min_sw_extension<true>(N, ex_opt, num_threads);
   else
-    compute_min_sw_extension<false>(N, ex_opt);
+    compute_min_sw_extension<false>(N, ex_opt, num_threads);
   
   std::cout << "silly extension:\n";
   print_extension(N, ex);
@@ -5,27 +5,91 @@
 #include "utils/network.hpp"
 #include "utils/generator.hpp"
 #include "utils/mul_wrapper.hpp" // treat networks as multi-labeled trees
-//#include "utils/tc_preprocess.hpp" // preprocessing
+#include "utils/tc_preprocess.hpp" // preprocessing
 
 #include "utils/containment.hpp"
+#include "utils/net_containment.hpp"
+#include "utils/incremental_containment.hpp"
+#include "utils/displayed_trees.hpp"
+#include "utils/pipeline.hpp"
+#include "solv/mul_tree.hpp"
 
 using namespace PT;
 
 OptionMap options;
+// the branching strategy of the containment engine (-B)
+std::shared_ptr<const BranchingStrategy> branching_strategy = default_branching_strategy();
+
 void parse_options(const int argc, const char** argv)
 {
   OptionDesc description;
   description["-v"] = {0,0};
   description["-r"] = {3,3};
+  description["-t"] = {1,1};
+  description["-u"] = {0,0};
+  description["-m"] = {1,1};
+  description["-b"] = {0,0};
+  description["-s"] = {1,1};
+  description["-f"] = {0,0};
+  description["-T"] = {1,1};
+  description["-N"] = {1,1};
+  description["-M"] = {1,1};
+  description["-c"] = {1,1};
+  description["-l"] = {0,0};
+  description["-e"] = {0,0};
+  description["-i"] = {1,1};
+  description["-d"] = {0,0};
+  description["-p"] = {0,0};
+  description["-B"] = {1,1};
+  description["-S"] = {0,0};
   description[""] = {0,2};
   const std::string help_message(std::string(argv[0]) + " <file1> [file2]\n\
       \tfile1 and file2 describe two networks (either file1 contains 2 lines of extended newick or both file1 and file2 describe a network in extended newick or edgelist format)\n\
       \tUnless the first network is a tree and the second is not, we try to embed the second network in the first.\n\
+      \tIf both are networks, we check whether the first displays all trees displayed by the second.\n\
       \n" + std::string(argv[0]) + " -r <x> <y> <z>\n\
-      \trandomize a tree with x internal nodes + y leaves and add z additional edges, then check containment of the tree in the network\n");
+      \trandomize a tree with x internal nodes + y leaves and add z additional edges, then check containment of the tree in the network\n\
+      \n\
+      -t <x>\texplore branches of the containment engine using x threads (default: 1); if the host is a tree, fill the table for disjoint subtrees of the guest in parallel\n\
+      -u\texplore branches in-place, rolling back failed branches via an undo-trail (instead of copying the engine for each branch)\n\
+      -b\tbatch mode: check each tree in the input against the first network in the input (with -t, trees are checked in parallel)\n\
+      -s <x>\tstreaming mode: the input file holds any number of records, each consisting of a network and a tree (1 line of extended newick each);\n\
+      \t\tthe records are parsed and checked concurrently and the results are written to the file x (- for stdout, in which case all other output goes to stderr) in input order\n\
+      \t\t(with -t, x records are checked in parallel)\n\
+      -m <x>\tremember the results of up to x sub-instances of the containment engine in a transposition table\n\
+      -B <x>\tchoose the reticulations to branch on with the strategy x: visibility (default), fewest-parents, most-constrained, or lookahead\n\
+      -S\treport statistics of the search of the containment engine for each depth of the search tree\n\
+      -p\tbefore running the containment engine, shrink the network and the tree by replacing subtrees of the network without\n\
+      \t\treticulations (which are stable on all their leaves and appear in every displayed tree) by single leaves, and report how much was removed\n\
+      -f\tbefore running the containment engine, try to prove that the tree is not displayed by cheap necessary conditions\n\
+      \t\t(leaf labels and clusters below bridges of the network), and report how many pairs were rejected this way\n\
+      -T <x>\tgive up the search of the containment engine after x seconds (per pair) and answer 'unknown'\n\
+      -N <x>\tgive up the search of the containment engine after x branchings (per pair) and answer 'unknown'\n\
+      -M <x>\tgive up the search of the containment engine once this process uses more than x MB of memory and answer 'unknown'\n\
+      -c <x>\tlook up each pair in the on-disk result cache x (created if it does not exist) before checking it, and store new results in it;\n\
+      \t\tthe cache can be shared by any number of runs and processes\n\
+      -i <x>\twith -b: afterwards, apply x random edits to the network (removing a reticulation arc or connecting two new nodes on\n\
+      \t\trandom arcs) and re-check the trees incrementally after each edit\n\
+      -d\tlist the distinct trees displayed by the first network in the input (in extended newick); with -t, in parallel\n\
+      -e\tif both inputs are networks, enumerate all trees displayed by the second and check each of them (for comparison)\n\
+      -l\tthe host is a multi-labeled tree (leaf labels may repeat): check containment of the tree with the MUL-tree mapper\n");
 
   parse_options(argc, argv, description, help_message, options);
 
+  if(test(options, "-t") && (stoi(options.at("-t")[0]) < 1)) {
+    std::cerr << "cannot run with "<<options.at("-t")[0]<<" threads\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if(test(options, "-B")) {
+    try{
+      branching_strategy = make_branching_strategy(options.at("-B")[0]);
+    } catch(const std::exception& err) {
+      std::cerr << err.what() << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
   if(test(options, "-r")){
     const auto r_vec = options.at("-r");
     if(stoi(r_vec[0]) == 0) {
@@ -52,6 +116,8 @@ using MyNet = CompatibleRWNetwork<MyTree>;
 // in any case, both label maps have the same type
 using LabelMap = typename MyTree::LabelMap;
 static_assert(std::is_same_v<LabelMap, typename MyNet::LabelMap>);
+// hosts for -l may have multiple leaves with the same label
+using MyMulTree = CompatibleMulTree<MyTree>;
 
 
 /*
@@ -95,32 +161,491 @@ NetAndTree create_net_and_tree()
   return { std::piecewise_construct, std::forward_as_tuple(std::move(N)), std::forward_as_tuple(std::move(el), node_labels, consecutive_tag())};
 }
 
-NetAndTree read_net_and_tree()
+using EdgesAndLabels = EdgesAndNodeLabels<MyTree, LabelMap>;
+
+// if any of -T, -N, -M, -S is given, return a new search budget with these limits (which also collects the search statistics)
+std::shared_ptr<SearchBudget> make_budget()
+{
+  if(!test(options, "-T") && !test(options, "-N") && !test(options, "-M") && !test(options, "-S")) return {};
+  auto budget = std::make_shared<SearchBudget>();
+  if(test(options, "-T")) budget->set_deadline(std::chrono::duration<double>(std::stod(options["-T"][0])));
+  if(test(options, "-N")) budget->set_max_branch_nodes(std::stoul(options["-N"][0]));
+  if(test(options, "-M")) budget->set_max_memory(std::stoul(options["-M"][0]) << 20);
+  return budget;
+}
+
+void print_search_stats(const SearchBudget& budget)
+{
+  const SearchStats stats = budget.stats();
+  std::cout << "search: "<< stats << "\n";
+  if(test(options, "-S"))
+    for(size_t d = 0; d < stats.levels.size(); ++d)
+      std::cout << "search depth "<< d <<": "<< stats.levels[d] << "\n";
+  if(budget.ran_out()) std::cout << "gave up: " << budget.why() << "\n";
+}
+
+// the on-disk result cache (-c), shared by all checks
+std::shared_ptr<ResultCache> result_cache;
+
+void open_result_cache()
+{
+  if(!test(options, "-c")) return;
+  try{
+    result_cache = std::make_shared<ResultCache>(options["-c"][0]);
+  } catch(const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// if the result cache knows the verdict for N and T, return it, otherwise compute it (by calling 'compute') and remember it
+//NOTE: the fingerprint of N and T is computed before calling 'compute', so 'compute' may move N and T
+template<class Host, class Guest, class Compute>
+Verdict cached(const Host& N, const Guest& T, Compute&& compute)
 {
-  std::vector<EdgesAndNodeLabels<MyTree, LabelMap>> el;
+  if(!result_cache) return compute();
+  return result_cache->decide(containment_fingerprint(N, T), std::forward<Compute>(compute));
+}
+
+NetAndTree make_net_and_tree(EdgesAndLabels& first, EdgesAndLabels& second)
+{
+  // choose which one is the host and which is the guest (we try to embed guest into host)
+  // if we've been given 2 trees, the first is considered the host, otherwise, the network is considered the host :)
+  const bool swap_roles = (first.is_tree() && !second.is_tree());
+  EdgesAndLabels& host = swap_roles ? second : first;
+  EdgesAndLabels& guest = swap_roles ? first : second;
+  return { std::piecewise_construct,
+           std::forward_as_tuple(std::move(host.edges), std::move(host.labels), consecutive_tag()),
+           std::forward_as_tuple(std::move(guest.edges), std::move(guest.labels), consecutive_tag()) };
+}
+
+std::vector<EdgesAndLabels> read_input()
+{
+  std::vector<EdgesAndLabels> el;
   read_edgelists(options[""][0], el);
 
   if(el.size() < 2){
     std::cerr << "could not read 2 networks from files "<<options[""]<<std::endl;
     exit(EXIT_FAILURE);
   }
+  return el;
+}
 
-  // choose which index corresponds to the host and which to the guest (we try to embed guest into host)
-  // if we've been given 2 trees, the first is considered the host, otherwise, the network is considered the host :)
-  const bool host_net_index = (el[0].is_tree() && !el[1].is_tree());
-  const bool guest_net_index = 1 - host_net_index;
-  return { std::piecewise_construct,
-           std::forward_as_tuple(std::move(el[host_net_index].edges), std::move(el[host_net_index].labels), consecutive_tag()),
-           std::forward_as_tuple(std::move(el[guest_net_index].edges), std::move(el[guest_net_index].labels), consecutive_tag()) };
+double ms_since(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// while this is alive, everything written to std::cout goes to stderr (like the chatter of the containment engines and of the
+// construction of networks, which may run in other threads), so that only what is written to 'out' goes to stdout
+struct ResultsToStdout
+{
+  std::streambuf* const stdout_buf;
+  std::ostream out;
+
+  ResultsToStdout(): stdout_buf(std::cout.rdbuf()), out(stdout_buf) { std::cout.rdbuf(std::cerr.rdbuf()); }
+  ~ResultsToStdout() { out.flush(); std::cout.rdbuf(stdout_buf); }
+};
+
+// apply a random edit to the host of the incremental checker: remove a random arc into a reticulation or subdivide two random arcs
+// and connect the new nodes (such that this does not create a cycle)
+template<class Incremental>
+void random_edit(Incremental& inc)
+{
+  const auto& N = inc.get_host();
+  NodeVec retis;
+  for(const Node x: N.nodes()) if(N.is_reti(x)) retis.push_back(x);
+  if(!retis.empty() && toss_coin()) {
+    const Node v = retis[throw_die(retis.size())];
+    const NodeVec v_parents(N.parents(v).begin(), N.parents(v).end());
+    const Node u = v_parents[throw_die(v_parents.size())];
+    std::cout << "removing arc "<<u<<" -> "<<v<<"\n";
+    inc.remove_edge(u, v);
+  } else {
+    std::vector<std::pair<Node, Node>> edges;
+    for(const auto& uv: N.edges()) edges.push_back(uv.as_pair());
+    if(edges.size() < 2) return;
+    while(1) {
+      const auto [a, b] = edges[throw_die(edges.size())];
+      const auto [c, d] = edges[throw_die(edges.size())];
+      if(((a != c) || (b != d)) && !N.has_path(d, a)) {
+        const auto [u, v] = inc.connect_arcs(a, b, c, d);
+        std::cout << "added arc "<<u<<" -> "<<v<<" from "<<a<<" -> "<<b<<" to "<<c<<" -> "<<d<<"\n";
+        return;
+      }
+    }
+  }
+}
+
+// apply random edits to the network and re-check the trees incrementally after each of them (-i)
+void check_incremental(const MyNet& N, const std::vector<MyTree>& trees, const size_t num_edits)
+{
+  IncrementalContainment<MyNet, MyTree> inc(N, trees);
+  const auto configure = [](auto& tc) {
+    if(test(options, "-u")) tc.use_undo_trail();
+    if(test(options, "-m")) tc.use_transposition_table(std::stoul(options["-m"][0]));
+    tc.use_branching_strategy(branching_strategy);
+    tc.use_budget(make_budget());
+  };
+  inc.decide_all(configure);
+  const auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < num_edits; ++i) {
+    random_edit(inc);
+    const auto& results = inc.decide_all(configure);
+    const size_t num_displayed = std::count(results.begin(), results.end(), Verdict::displayed);
+    std::cout << "edit "<< i <<": "<< num_displayed <<" of "<< results.size() <<" trees displayed\n";
+  }
+  std::cout << "incremental checks: "<< inc.get_stats() << " in "<< ms_since(start) <<"ms\n";
+}
+
+// check all trees in the input against the first network in the input, preprocessing the network only once
+void check_batch()
+{
+  std::vector<EdgesAndLabels> el;
+  read_edgelists(options[""], el);
+
+  if(el.size() < 2){
+    std::cerr << "could not read a network and at least one tree from files "<<options[""]<<std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  const MyNet N(std::move(el[0].edges), std::move(el[0].labels), consecutive_tag());
+  std::vector<MyTree> trees;
+  trees.reserve(el.size() - 1);
+  for(size_t i = 1; i < el.size(); ++i) {
+    if(!el[i].is_tree()) {
+      std::cerr << "input number "<<i<<" is not a tree, cannot check network-network containment in batch mode"<<std::endl;
+      exit(EXIT_FAILURE);
+    }
+    trees.emplace_back(std::move(el[i].edges), std::move(el[i].labels), consecutive_tag());
+  }
+
+  std::cout << "\n\n preprocessing the network for "<<trees.size()<<" trees...\n\n";
+  TreeInNetBatchContainment<MyNet, MyTree> batch(N);
+  if(test(options, "-f")) batch.use_filter();
+  batch.use_result_cache(result_cache);
+  const size_t num_threads = test(options, "-t") ? std::stoi(options["-t"][0]) : 1;
+  const auto results = batch.decide_all(trees, num_threads, [](auto& tc) {
+      if(test(options, "-u")) tc.use_undo_trail();
+      if(test(options, "-m")) tc.use_transposition_table(std::stoul(options["-m"][0]));
+      tc.use_branching_strategy(branching_strategy);
+      tc.use_budget(make_budget());
+    });
+
+  for(size_t i = 0; i < results.size(); ++i)
+    std::cout << "tree "<< i <<": "<< results[i] << "\n";
+  if(test(options, "-i")) check_incremental(N, trees, std::stoul(options["-i"][0]));
+  if(batch.get_filter())
+    std::cout << "pre-filter: "<< *batch.get_filter() << "\n";
+  if(result_cache)
+    std::cout << "result cache: "<< *result_cache << "\n";
+}
+
+// streaming mode: reading, parsing, checking and writing run concurrently, connected by bounded queues,
+// so the memory used does not depend on the number of records in the input
+struct StreamRecord
+{
+  size_t number;
+  std::string lines[2];
+  size_t num_lines = 0;
+};
+
+struct ParsedRecord
+{
+  size_t number;
+  std::optional<NetAndTree> NT;
+  std::string status; // if parsing failed, say why
+  double parse_ms = 0;
+};
+
+struct CheckedRecord
+{
+  std::string status;
+  double parse_ms = 0;
+  double check_ms = 0;
+};
+
+ParsedRecord parse_record(StreamRecord&& rec)
+{
+  const auto start = std::chrono::steady_clock::now();
+  ParsedRecord result{rec.number, std::nullopt, ""};
+  if(rec.num_lines < 2) {
+    result.status = "malformed (missing tree)";
+  } else {
+    try{
+      EdgesAndLabels el[2];
+      for(size_t i = 0; i < 2; ++i)
+        el[i].num_nodes = parse_newick(rec.lines[i], el[i].edges, *el[i].labels);
+      result.NT.emplace(make_net_and_tree(el[0], el[1]));
+    } catch(const MalformedNewick& err) {
+      result.status = std::string("malformed (") + err.what() + ")";
+      std::replace(result.status.begin(), result.status.end(), '\n', ' ');
+    }
+  }
+  result.parse_ms = ms_since(start);
+  return result;
+}
+
+// the number of records that were checked by, and rejected by the pre-filter (-f)
+std::atomic<size_t> num_prefiltered = 0;
+std::atomic<size_t> num_rejected = 0;
+
+bool prefilter_rejects(const MyNet& N, const MyTree& T)
+{
+  ++num_prefiltered;
+  if(ContainmentFilter<MyNet>(N).rejects(T)) {
+    ++num_rejected;
+    return true;
+  } else return false;
+}
+
+CheckedRecord check_record(ParsedRecord&& rec)
+{
+  const auto start = std::chrono::steady_clock::now();
+  CheckedRecord result{rec.status, rec.parse_ms};
+  if(rec.NT) {
+    MyNet& N = rec.NT->first;
+    MyTree& T = rec.NT->second;
+    try{
+      if(!T.is_tree()) {
+        result.status = "unsupported (network-network containment)";
+      } else {
+        std::stringstream why_unknown;
+        const Verdict verdict = cached(N, T, [&]{
+            if(test(options, "-f") && prefilter_rejects(N, T)) return Verdict::not_displayed;
+            if(N.is_tree()) {
+              TreeInTreeContainment tc(std::move(N.as_tree()), std::move(T));
+              return tc.displayed() ? Verdict::displayed : Verdict::not_displayed;
+            }
+            TreeInNetContainment tc(std::move(N), std::move(T));
+            if(test(options, "-u")) tc.use_undo_trail();
+            if(test(options, "-m")) tc.use_transposition_table(std::stoul(options["-m"][0]));
+            tc.use_branching_strategy(branching_strategy);
+            tc.use_budget(make_budget());
+            const Verdict tc_verdict = tc.decide();
+            if(tc.get_budget() && tc.get_budget()->ran_out()) why_unknown << " (" << tc.get_budget()->why() << ")";
+            return tc_verdict;
+          });
+        std::stringstream status;
+        status << verdict << why_unknown.str();
+        result.status = status.str();
+      }
+    } catch(const std::exception& err) {
+      result.status = std::string("error (") + err.what() + ")";
+    }
+  }
+  result.check_ms = ms_since(start);
+  return result;
+}
+
+void check_stream()
+{
+  std::ifstream in(options[""][0]);
+  if(!in) {
+    std::cerr << options[""][0] << " cannot be opened for reading" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::ofstream out_file;
+  // when writing the results to stdout, everything else goes to stderr, so it does not mix with the result lines
+  std::optional<ResultsToStdout> to_stdout;
+  if(options["-s"][0] == "-") {
+    to_stdout.emplace();
+  } else {
+    out_file.open(options["-s"][0]);
+    if(!out_file) {
+      std::cerr << options["-s"][0] << " cannot be opened for writing" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  std::ostream& out = to_stdout ? to_stdout->out : out_file;
+
+  const size_t num_checkers = test(options, "-t") ? std::stoi(options["-t"][0]) : 1;
+  BoundedQueue<StreamRecord> raw_records(2 * num_checkers);
+  BoundedQueue<ParsedRecord> parsed_records(2 * num_checkers);
+  ReorderBuffer<CheckedRecord> checked_records(4 * num_checkers);
+
+  std::thread reader([&]{
+      StreamRecord rec{0, {}, 0};
+      std::string line;
+      while(std::getline(in, line)) {
+        if(std::all_of(line.begin(), line.end(), [](const char c){ return std::isspace(c); })) continue;
+        rec.lines[rec.num_lines++] = std::move(line);
+        if(rec.num_lines == 2) {
+          const size_t number = rec.number;
+          raw_records.push(std::move(rec));
+          rec = StreamRecord{number + 1, {}, 0};
+        }
+      }
+      if(rec.num_lines) raw_records.push(std::move(rec));
+      raw_records.close();
+    });
+
+  std::thread parser([&]{
+      while(auto rec = raw_records.pop())
+        parsed_records.push(parse_record(std::move(*rec)));
+      parsed_records.close();
+    });
+
+  std::vector<std::thread> checkers;
+  std::atomic<size_t> running_checkers = num_checkers;
+  for(size_t i = 0; i < num_checkers; ++i)
+    checkers.emplace_back([&]{
+        while(auto rec = parsed_records.pop()) {
+          const size_t number = rec->number;
+          checked_records.put(number, check_record(std::move(*rec)));
+        }
+        if(--running_checkers == 0) checked_records.close();
+      });
+
+  out << "# record\tstatus\tparse ms\tcheck ms\n";
+  for(size_t number = 0; auto rec = checked_records.get(); ++number)
+    out << number << '\t' << rec->status << '\t' << rec->parse_ms << '\t' << rec->check_ms << '\n';
+  if(test(options, "-f"))
+    out << "# pre-filter rejected "<< num_rejected << " of "<< num_prefiltered << " records\n";
+  if(result_cache)
+    out << "# result cache: "<< *result_cache << "\n";
+  out.flush();
+
+  reader.join();
+  parser.join();
+  for(auto& t: checkers) t.join();
+}
+
+// check whether the host network displays all trees displayed by the guest network
+void check_net_in_net(EdgesAndLabels& host, EdgesAndLabels& guest)
+{
+  MyNet N(std::move(host.edges), std::move(host.labels), consecutive_tag());
+  MyNet G(std::move(guest.edges), std::move(guest.labels), consecutive_tag());
+  if(test(options, "-v"))
+    std::cout << "N:\n" << N << "\n" << get_extended_newick(N) << "\nG:\n" << G << "\n"<< get_extended_newick(G)<<"\n";
+
+  const Verdict result = cached(N, G, [&]{
+      std::cout << "\n\n starting the network-containment engine...\n\n";
+      NetInNetContainment<MyNet, MyNet> nc(std::move(N), std::move(G));
+      if(test(options, "-f")) nc.get_batch().use_filter();
+      nc.use_budget(make_budget());
+      const auto configure = [](auto& tc) {
+        if(test(options, "-u")) tc.use_undo_trail();
+        if(test(options, "-m")) tc.use_transposition_table(std::stoul(options["-m"][0]));
+        tc.use_branching_strategy(branching_strategy);
+      };
+      const auto start = std::chrono::steady_clock::now();
+      const Verdict nc_result = test(options, "-e") ? nc.decide_by_enumeration(configure) : nc.decide(configure);
+      std::cout << "network containment: "<< nc.get_stats() << " in "<< ms_since(start) << "ms\n";
+      if(const auto& budget = nc.get_budget()) print_search_stats(*budget);
+      return nc_result;
+    });
+  if(result_cache)
+    std::cout << "result cache: "<< *result_cache << "\n";
+  std::cout << result << "\n";
+}
+
+// list the distinct trees displayed by the first network in the input (-d)
+void list_displayed_trees()
+{
+  // the trees are constructed concurrently, so whatever reading and constructing networks prints goes to stderr
+  ResultsToStdout results;
+  std::vector<EdgesAndLabels> el;
+  read_edgelists(options[""], el);
+  if(el.empty()){
+    std::cerr << "could not read a network from files "<<options[""]<<std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const MyNet N(std::move(el[0].edges), std::move(el[0].labels), consecutive_tag());
+  const size_t num_threads = test(options, "-t") ? std::stoi(options["-t"][0]) : 1;
+  std::mutex out_lock;
+  const auto start = std::chrono::steady_clock::now();
+  const DisplayedTreesStats stats = for_each_displayed_tree(N, [&](const auto& T) {
+      const std::string newick = get_extended_newick(T);
+      const std::lock_guard<std::mutex> guard(out_lock);
+      results.out << "displayed tree: " << newick << "\n";
+      return true;
+    }, num_threads);
+  results.out << "displayed trees: "<< stats << " in "<< ms_since(start) << "ms\n";
+}
+
+// check containment of a tree in a multi-labeled tree (-l)
+void check_mul_tree()
+{
+  std::vector<EdgesAndLabels> el;
+  read_edgelists(options[""], el);
+
+  if((el.size() < 2) || !el[0].is_tree() || !el[1].is_tree()){
+    std::cerr << "could not read 2 trees from files "<<options[""]<<std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const MyMulTree N(std::move(el[0].edges), std::move(el[0].labels), consecutive_tag());
+  const MyTree T(std::move(el[1].edges), std::move(el[1].labels), consecutive_tag());
+  if(test(options, "-v"))
+    std::cout << "N:\n" << N << "\n" << get_extended_newick(N) << "\nT:\n" << T << "\n"<< get_extended_newick(T)<<"\n";
+
+  const Verdict result = cached(N, T, [&]{
+      std::cout << "running MUL-mapper"<<std::endl;
+      MULTreeMapper<MyMulTree, MyTree> mapper(N, T);
+      return mapper.verify_display() ? Verdict::displayed : Verdict::not_displayed;
+    });
+  if(result_cache)
+    std::cout << "result cache: "<< *result_cache << "\n";
+  std::cout << result << "\n";
+}
+
+// run the containment engine for the tree T in N (which may be modified or moved)
+template<class Tree>
+Verdict run_containment(MyNet& N, Tree& T)
+{
+  std::cout << "\n\n starting the containment engine...\n\n";
+  if(N.is_tree()){
+    TreeInTreeContainment tc(std::move(N.as_tree()), std::move(T));
+    if(test(options, "-t")) tc.set_num_threads(std::stoi(options["-t"][0]));
+    return tc.displayed() ? Verdict::displayed : Verdict::not_displayed;
+  } else {
+    TreeInNetContainment tc(std::move(N), std::move(T));
+    if(test(options, "-t")) tc.set_num_threads(std::stoi(options["-t"][0]));
+    if(test(options, "-u")) tc.use_undo_trail();
+    if(test(options, "-m")) tc.use_transposition_table(std::stoul(options["-m"][0]));
+    tc.use_branching_strategy(branching_strategy);
+    tc.use_budget(make_budget());
+    const Verdict tc_result = tc.decide();
+    if(tc.get_transposition_table())
+      std::cout << "transposition table: "<< *tc.get_transposition_table() << "\n";
+    if(const auto& budget = tc.get_budget()) print_search_stats(*budget);
+    return tc_result;
+  }
 }
 
 int main(const int argc, const char** argv)
 {
   parse_options(argc, argv);
+  open_result_cache();
+
+  if(test(options, "-b")) {
+    check_batch();
+    return 0;
+  }
+  if(test(options, "-s")) {
+    check_stream();
+    return 0;
+  }
+  if(test(options, "-l")) {
+    check_mul_tree();
+    return 0;
+  }
+  if(test(options, "-d")) {
+    list_displayed_trees();
+    return 0;
+  }
 
+  std::vector<EdgesAndLabels> el;
+  if(!test(options, "-r")) {
+    el = read_input();
+    if(!el[0].is_tree() && !el[1].is_tree()) {
+      check_net_in_net(el[0], el[1]);
+      return 0;
+    }
+  }
   auto NT_tuple = test(options, "-r") ?
     create_net_and_tree() :
-    read_net_and_tree();
+    make_net_and_tree(el[0], el[1]);
 
   MyNet& N = NT_tuple.first;
   MyTree& T = NT_tuple.second;
@@ -128,19 +653,27 @@ int main(const int argc, const char** argv)
   if(test(options, "-v"))
     std::cout << "N:\n" << N << "\n" << get_extended_newick(N) << "\nT:\n" << T << "\n"<< get_extended_newick(T)<<"\n";
 
-  std::cout << "\n\n starting the containment engine...\n\n";
   if(T.is_tree()) {
-    if(N.is_tree()){
-      TreeInTreeContainment tc(std::move(N.as_tree()), std::move(T));
-      if(tc.displayed())
-        std::cout << "displayed\n"; // by subtrees rooted at: "<< tc.who_displays(T.root()).front() << "\n";
-      else std::cout << "not displayed\n";
-    } else {
-      TreeInNetContainment tc(std::move(N), std::move(T));
-      if(tc.displayed())
-        std::cout << "displayed\n"; // by subtrees rooted at: "<< tc.who_displays(T.root()).front() << "\n";
-      else std::cout << "not displayed\n";
-    }
-  } else std::cout << "sorry, can't check network-network containment yet...\n";
+    const Verdict result = cached(N, T, [&]{
+        if(test(options, "-f")) {
+          const ContainmentFilter<MyNet> filter(N);
+          const bool rejected = filter.rejects(T);
+          std::cout << "pre-filter: "<< filter << "\n";
+          if(rejected) return Verdict::not_displayed;
+        }
+
+        if(test(options, "-p")) {
+          CompatibleRWTree<MyTree> RT(T);
+          const auto start = std::chrono::steady_clock::now();
+          TC_Preprocessor prep(N, RT);
+          const Verdict prep_result = prep.apply();
+          std::cout << "preprocessing: "<< prep.get_stats() << " in "<< ms_since(start) << "ms\n";
+          return (prep_result != Verdict::unknown) ? prep_result : run_containment(N, RT);
+        } else return run_containment(N, T);
+      });
+    if(result_cache)
+      std::cout << "result cache: "<< *result_cache << "\n";
+    std::cout << result << "\n";
+  } else std::cout << "sorry, can't check containment of a network in a tree...\n";
 }
 
@@ -3,85 +3,231 @@
 
 #include "utils/utils.hpp"
 #include "utils/types.hpp"
-#include "utils/network.hpp"
-#include "utils/label_map.hpp"
+#include "utils/iter_bitset.hpp"
+#include "utils/matching.hpp"
+#include "utils/lca.hpp"
+#include "utils/kway_merge.hpp"
 #include "mapper.hpp"
 
 #include <algorithm>
 
 namespace PT{
 
-
-
-  template<class MULTree>
-  class MULTreeMapper: public Mapper<MULTree, MULabelMap>
+  // a mapper for a single-labeled guest tree T in a multi-labeled host tree N (MUL-tree)
+  // the nodes of N displaying a node u of T are found in the subtree of N induced by the nodes displaying the children of u:
+  // we merge the sorted lists of the children of u, "coloring" each node by the children of u that it displays, and sweep the
+  // merged list once, building the induced subtree on a stack (each new node is an LCA of two consecutive nodes in the list)
+  // a node v of the induced subtree displays u if the children of u can be assigned to distinct children of v such that each child
+  // of v displays (or has a descendant displaying) the child of u assigned to it; for binary u, this is a simple counting argument,
+  // otherwise we compute a bipartite matching between the children of u and those of v
+  //NOTE: all lists are sorted by preorder number in N, and LCAs are computed in constant time (see lca.hpp)
+  template<class MULTree, class Guest>
+  class MULTreeMapper: public Mapper<MULTree, Guest>
   {
-    using Parent = Mapper<MULTree, MULabelMap>;
+    using Parent = Mapper<MULTree, Guest>;
     using Parent::N;
     using Parent::T;
-    using Parent::labelmap;
     using Parent::display_map;
-    using typename Parent::LabelType;
+
+    using LabelType = std::remove_cvref_t<typename MULTree::LabelType>;
+
+    // for u with up to 64 children, the children displayed by a node are stored in a word, otherwise in a bitset
+    using SmallColors = uint64_t;
+    using LargeColors = std::unordered_bitset;
+
+    // a node of the merged list (or of the induced subtree) together with the children of u that it (or its subtree) displays
+    template<class Colors>
+    struct ColoredNode
+    {
+      Node node;
+      Colors colors;
+      bool below_displays = false; // indicate whether some node in the subtree (below or at) node displays u
+    };
+
+    // a node of the induced subtree whose subtree is still under construction
+    //NOTE: its children are the entries of 'finished' starting at first_child
+    template<class Colors>
+    struct OpenNode
+    {
+      Node node;
+      Colors colors;
+      size_t first_child;
+    };
+
+    template<class Colors>
+    struct Workspace
+    {
+      std::vector<ColoredNode<Colors>> merged;
+      std::vector<OpenNode<Colors>> stack;
+      std::vector<ColoredNode<Colors>> finished;
+    };
+
+    const ConstantTimeLCA<MULTree> lca;
+    // for each label, the leaves of N having this label (sorted by preorder number)
+    HashMap<LabelType, NodeVec> leaves_by_label;
+
+    Workspace<SmallColors> small_ws;
+    Workspace<LargeColors> large_ws;
+    KWayMerge<NodeVec::const_iterator> merger;
+    BipartiteMatching matcher;
+
+    static void add_color(SmallColors& c, const size_t i) { c |= (1ul << i); }
+    static void add_color(LargeColors& c, const size_t i) { c.set(i); }
+    static size_t num_colors(const SmallColors c) { return __builtin_popcountl(c); }
+    static size_t num_colors(const LargeColors& c) { return c.count(); }
+    template<class Function>
+    static void for_each_color(SmallColors c, Function&& f)
+    {
+      for(; c; c &= c - 1) f(__builtin_ctzl(c));
+    }
+    template<class Function>
+    static void for_each_color(const LargeColors& c, Function&& f) { for(const size_t i: c) f(i); }
+
+    bool sort_by_preorder(const Node x, const Node y) const { return lca.preorder_number(x) < lca.preorder_number(y); }
 
   public:
-    using Parent::Mapper;
+
+    MULTreeMapper(const MULTree& _N, const Guest& _T): Parent(_N, _T), lca(_N)
+    {
+      for(const Node x: N.dfs().preorder())
+        if(N.is_leaf(x)) leaves_by_label[N.label(x)].push_back(x);
+    }
+
     using Parent::who_displays;
     using Parent::verify_display;
 
   protected:
-    // get subtrees of N displaying the subtree of T rooted at v
+
+    void get_displaying_vertices_leaf(const Node u, NodeVec& result) override
+    {
+      const auto iter = leaves_by_label.find(T.label(u));
+      if(iter != leaves_by_label.end()) result = iter->second;
+    }
+
+    // get subtrees of N displaying the subtree of T rooted at u
     //NOTE: result will be sorted
-    void get_displaying_vertices_binary(const Tree::Node& v, IndexVec& result)
+    void get_displaying_vertices(const Node u, NodeVec& result) override
+    {
+      if(T.out_degree(u) <= 8 * sizeof(SmallColors))
+        get_displaying_vertices(u, result, small_ws);
+      else
+        get_displaying_vertices(u, result, large_ws);
+    }
+
+    template<class Colors>
+    void get_displaying_vertices(const Node u, NodeVec& result, Workspace<Colors>& ws)
     {
-      const uint32_t child0 = v.out[0].head();
-      const uint32_t child1 = v.out[1].head();
-
-      const IndexVec& displaying1 = who_displays(child0);
-      std::cout << "we know that "<<child0<<" is displayed at "<<displaying1<<std::endl;
-      if(displaying1.empty()) return;
-
-      const IndexVec& displaying2 = who_displays(child1);
-      std::cout << "we know that "<<child1<<" is displayed at "<<displaying2<<std::endl;
-      if(displaying2.empty()) return;
-
-      for(uint32_t id1 = 0, id2 = 0;;){
-        std::cout << "checking indices "<<id1<<" & "<<id2<<std::endl;
-        //NOTE: by always advancing the smaller of displaying1[id1] and displaying2[id2],
-        //      we know that every set of LCAs that are ancestors of one another will be consecutive.
-        //      Thus, we only need to check against the last LCA to maintain minimality of the
-        //      items in result (this needs T being monotone and binary though)
-        const uint32_t x = displaying1[id1];
-        const uint32_t y = displaying2[id2];
-        const uint32_t xy_lca = N.LCA(x, y);
-        if(x < y) {
-          // if the lca is among x and y, then it is x
-          if((xy_lca != x) && (result.empty() || (N.get_minimum(result.back(), xy_lca) == UINT32_MAX)))
-            result.push_back(xy_lca);
-          // next, advance id1 or, if impossible advance id2
-          if(id1 == displaying1.size() - 1){
-            if(++id2 == displaying2.size()) break;
-          } else ++id1;
-        } else {
-          // if the lca is among x and y, then it is y
-          if((xy_lca != y) && (result.empty() && (N.get_minimum(result.back(), xy_lca) == UINT32_MAX)))
-            result.push_back(xy_lca);
-          // next, advance id2 or, if impossible advance id1
-          if(id2 == displaying2.size() - 1){
-            if(++id1 == displaying1.size()) break;
-          } else ++id2;
+      if(!merge_child_poss(u, ws.merged)) return;
+      const size_t num_children = T.out_degree(u);
+      auto& stack = ws.stack;
+      auto& finished = ws.finished;
+      stack.clear();
+      finished.clear();
+
+      // close the top of the stack: evaluate it (its subtree is complete now) and move it to 'finished' as a child of the next node
+      const auto close_top = [&]() {
+        const OpenNode<Colors>& top = stack.back();
+        ColoredNode<Colors> closed{top.node, top.colors, false};
+        for(size_t i = top.first_child; i < finished.size(); ++i) {
+          closed.colors |= finished[i].colors;
+          closed.below_displays |= finished[i].below_displays;
+        }
+        //NOTE: if a node below displays u, then we're not minimal, so don't bother checking
+        if(!closed.below_displays && displays(u, num_children, closed.colors, finished, top.first_child)) {
+          DEBUG3(std::cout << closed.node << " displays "<<u<<"\n");
+          result.push_back(closed.node);
+          closed.below_displays = true;
+        }
+        finished.resize(top.first_child);
+        stack.pop_back();
+        finished.push_back(std::move(closed));
+      };
+
+      for(auto& x: ws.merged) {
+        if(!stack.empty()) {
+          const Node x_lca = lca(stack.back().node, x.node);
+          const uint32_t lca_depth = lca.depth(x_lca);
+          // close all nodes on the stack that are strictly below the LCA, except the highest of them
+          while((stack.size() > 1) && (lca.depth(stack[stack.size() - 2].node) >= lca_depth)) close_top();
+          if(stack.back().node != x_lca) {
+            // the LCA is a new node of the induced subtree, whose first child is the top of the stack
+            const size_t first_child = stack.back().first_child;
+            close_top();
+            stack.push_back({x_lca, Colors(), first_child});
+          }
         }
+        stack.push_back({x.node, std::move(x.colors), finished.size()});
       }
-      // note that result may not be sorted, so we sort it ourselves
-      std::sort(result.begin(), result.end());
+      while(!stack.empty()) close_top();
+      std::sort(result.begin(), result.end(), [this](const Node x, const Node y) { return sort_by_preorder(x, y); });
     }
 
-    void initialize() {}
-
-    const IndexVec& emplace_leaf_entry_hint(const DisplayMap::iterator& hint, const uint32_t v_idx, const LabelType& displaying)
+    // merge the (sorted) lists of the children of u into 'merged', coloring each node with the children of u that it displays
+    // return false if some child of u cannot be displayed at all
+    template<class Colors>
+    bool merge_child_poss(const Node u, std::vector<ColoredNode<Colors>>& merged)
     {
-      return displaying;
+      merged.clear();
+      for(const Node v: T.children(u)) {
+        const NodeVec& v_poss = display_map.at(v);
+        if(v_poss.empty()) {
+          merger.clear();
+          return false;
+        }
+        merger.add_run(v_poss);
+      }
+      // the i'th child of u gets color i (all runs are non-empty, so the run indices are the indices of the children)
+      merger.merge([this](const Node x) { return lca.preorder_number(x); },
+                   [&merged](const Node x, const size_t color) {
+                     ColoredNode<Colors>& cx = merged.emplace_back();
+                     cx.node = x;
+                     add_color(cx.colors, color);
+                   });
+
+      // a node may display multiple children of u, in which case its copies are consecutive now and we unite their colors
+      size_t last = 0;
+      for(size_t i = 1; i < merged.size(); ++i) {
+        if(merged[i].node == merged[last].node)
+          merged[last].colors |= merged[i].colors;
+        else if(++last != i)
+          merged[last] = std::move(merged[i]);
+      }
+      merged.resize(last + 1);
+      return true;
     }
-  public:
 
+    // return whether a node of the induced subtree with the given children (the entries of 'children' starting at first_child) displays u
+    //NOTE: the children of a node of the induced subtree are in distinct subtrees below the node in N,
+    //      so the node displays u if and only if we can assign the children of u to distinct children of the node
+    //NOTE: colors contains the union of all colors in the subtree, but the node's own colors don't help it display u
+    template<class Colors>
+    bool displays(const Node u,
+                  const size_t num_children,
+                  const Colors& colors,
+                  const std::vector<ColoredNode<Colors>>& children,
+                  const size_t first_child)
+    {
+      const size_t num_node_children = children.size() - first_child;
+      if((num_node_children < num_children) || (num_colors(colors) < num_children)) return false;
+      if(num_children == 2) {
+        // we can assign both colors to distinct children unless a single child has both colors and no other child has any
+        size_t has_color[2] = {0, 0};
+        size_t has_both = 0;
+        for(size_t i = first_child; i < children.size(); ++i) {
+          bool child_has[2] = {false, false};
+          for_each_color(children[i].colors, [&](const size_t c){ child_has[c] = true; });
+          has_color[0] += child_has[0];
+          has_color[1] += child_has[1];
+          has_both += child_has[0] && child_has[1];
+        }
+        return (has_color[0] > 0) && (has_color[1] > 0) && !((has_color[0] == 1) && (has_color[1] == 1) && (has_both == 1));
+      } else {
+        // the colors are the left side and the children of the node are the right side
+        matcher.clear(num_children);
+        for(size_t i = first_child; i < children.size(); ++i)
+          for_each_color(children[i].colors, [&](const size_t c){ matcher.add_edge(c, i - first_child); });
+        return matcher.has_perfect_matching();
+      }
+    }
   };
 }
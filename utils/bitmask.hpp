@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "utils.hpp"
+
+/*
+ * small sets of nodes as fixed-width bitmasks, for algorithms that enumerate many subsets of a small set of nodes (like the
+ * scanwidth DP, which enumerates subsets of the nodes of a block)
+ * (1) the nodes are relabeled into 0, ..., k-1 by a DenseNodeIndex
+ * (2) a FixedBitmask<words> is a set of such labels, using 'words' machine words (so 1 word for up to 64 nodes)
+ * (3) a BitmaskMap is an open-addressing hash map with FixedBitmasks as keys
+ * (4) a DenseNodeSet is a FixedBitmask that looks like a set of nodes from the outside (so it can be filled by code that talks
+ *     about nodes, like the NetworkConstraintSubsetIterator)
+ */
+
+namespace PT{
+
+  template<size_t words>
+  class FixedBitmask
+  {
+    std::array<uint64_t, words> bits = {};
+  public:
+    static constexpr size_t capacity = 64 * words;
+
+    bool test(const size_t i) const { return (bits[i / 64] >> (i % 64)) & 1; }
+    void set(const size_t i) { bits[i / 64] |= (1ul << (i % 64)); }
+    void reset(const size_t i) { bits[i / 64] &= ~(1ul << (i % 64)); }
+
+    // return a copy of this mask without i
+    FixedBitmask without(const size_t i) const { FixedBitmask result(*this); result.reset(i); return result; }
+
+    size_t count() const
+    {
+      size_t result = 0;
+      for(const uint64_t w: bits) result += __builtin_popcountl(w);
+      return result;
+    }
+    bool empty() const
+    {
+      for(const uint64_t w: bits) if(w) return false;
+      return true;
+    }
+    // return whether this mask and the other have a common element
+    bool intersects(const FixedBitmask& other) const
+    {
+      for(size_t j = 0; j < words; ++j) if(bits[j] & other.bits[j]) return true;
+      return false;
+    }
+    // return whether all elements of this mask are in the other
+    bool is_subset_of(const FixedBitmask& other) const
+    {
+      for(size_t j = 0; j < words; ++j) if(bits[j] & ~other.bits[j]) return false;
+      return true;
+    }
+
+    // call f(i) for each i in the mask in increasing order
+    template<class F>
+    void for_each(F&& f) const
+    {
+      for(size_t j = 0; j < words; ++j)
+        for(uint64_t w = bits[j]; w; w &= w - 1)
+          f(64 * j + __builtin_ctzl(w));
+    }
+
+    // the smallest element that is at least i (capacity if there is none)
+    size_t next(const size_t i) const
+    {
+      size_t j = i / 64;
+      if(j >= words) return capacity;
+      uint64_t w = bits[j] & (~0ul << (i % 64));
+      while(!w) {
+        if(++j == words) return capacity;
+        w = bits[j];
+      }
+      return 64 * j + __builtin_ctzl(w);
+    }
+
+    size_t hash() const
+    {
+      size_t result = words;
+      for(const uint64_t w: bits) result = hash_combine(result, uint64_hash(w));
+      return result;
+    }
+
+    bool operator==(const FixedBitmask& other) const { return bits == other.bits; }
+    bool operator!=(const FixedBitmask& other) const { return bits != other.bits; }
+
+    friend std::ostream& operator<<(std::ostream& os, const FixedBitmask& m)
+    {
+      os << '{';
+      bool first = true;
+      m.for_each([&](const size_t i){ if(!first) os << ','; os << i; first = false; });
+      return os << '}';
+    }
+  };
+
+  // an open-addressing (linear probing) hash map from bitmasks to values
+  // the entries are stored contiguously in insertion order and the table only holds their indices, so empty slots cost 4 bytes
+  //NOTE: pointers to values are invalidated when inserting new keys
+  template<class Mask, class Value>
+  class BitmaskMap
+  {
+    using Entry = std::pair<Mask, Value>;
+
+    std::vector<Entry> entries;
+    // each slot holds 1 + the index of its entry, or 0 if it is empty; the number of slots is a power of 2
+    std::vector<uint32_t> slots;
+
+    size_t slot_of(const Mask& key) const
+    {
+      const size_t mod_mask = slots.size() - 1;
+      for(size_t s = key.hash() & mod_mask; ; s = (s + 1) & mod_mask) {
+        const uint32_t idx = slots[s];
+        if((idx == 0) || (entries[idx - 1].first == key)) return s;
+      }
+    }
+
+    void rehash(const size_t num_slots)
+    {
+      slots.assign(num_slots, 0);
+      for(size_t i = 0; i < entries.size(); ++i) slots[slot_of(entries[i].first)] = i + 1;
+    }
+
+  public:
+
+    using iterator = typename std::vector<Entry>::iterator;
+    using const_iterator = typename std::vector<Entry>::const_iterator;
+
+    BitmaskMap() { rehash(16); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() { entries.clear(); slots.assign(16, 0); }
+    void reserve(const size_t n)
+    {
+      entries.reserve(n);
+      size_t num_slots = slots.size();
+      while(2 * n > num_slots) num_slots *= 2;
+      if(num_slots != slots.size()) rehash(num_slots);
+    }
+
+    // the entries in insertion order
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    const Entry& operator[](const size_t i) const { return entries[i]; }
+
+    // return a pointer to the value of the given key, or nullptr if the key is not in the map
+    Value* find(const Mask& key)
+    {
+      const uint32_t idx = slots[slot_of(key)];
+      return idx ? &(entries[idx - 1].second) : nullptr;
+    }
+    const Value* find(const Mask& key) const { return const_cast<BitmaskMap*>(this)->find(key); }
+
+    Value& at(const Mask& key)
+    {
+      Value* const result = find(key);
+      if(!result) throw std::out_of_range("key not in bitmask map");
+      return *result;
+    }
+    const Value& at(const Mask& key) const { return const_cast<BitmaskMap*>(this)->at(key); }
+
+    // insert a value for the key (constructed from args), unless the key is already in the map
+    // return a pointer to the value for the key and whether it was inserted
+    template<class... Args>
+    std::pair<Value*, bool> try_emplace(const Mask& key, Args&&... args)
+    {
+      // keep the load factor below 1/2
+      if(2 * (entries.size() + 1) > slots.size()) rehash(2 * slots.size());
+      uint32_t& idx = slots[slot_of(key)];
+      if(idx) return {&(entries[idx - 1].second), false};
+      entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+      idx = entries.size();
+      return {&(entries.back().second), true};
+    }
+  };
+
+  // a relabeling of some nodes into 0, ..., k-1
+  struct DenseNodeIndex
+  {
+    NodeVec nodes;
+    HashMap<Node, size_t> index;
+
+    size_t size() const { return nodes.size(); }
+    size_t add(const Node u)
+    {
+      const auto [iter, success] = index.try_emplace(u, nodes.size());
+      if(success) nodes.push_back(u);
+      return iter->second;
+    }
+    size_t operator[](const Node u) const { return index.at(u); }
+    Node node(const size_t i) const { return nodes[i]; }
+  };
+
+  // a set of nodes of a DenseNodeIndex, stored as a bitmask of their labels
+  //NOTE: this provides the interface of a set of nodes (emplace, erase, count, iteration), so it can be used as a container by
+  //      code that is written for sets of nodes
+  template<class Mask>
+  class DenseNodeSet
+  {
+    const DenseNodeIndex* nodes = nullptr;
+    Mask bits;
+  public:
+    using value_type = Node;
+    using reference = Node;
+    using const_reference = Node;
+
+    class iterator
+    {
+      const DenseNodeSet* set;
+      size_t pos;
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Node;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = Node;
+
+      iterator(const DenseNodeSet& _set, const size_t _pos): set(&_set), pos(_set.bits.next(_pos)) {}
+      Node operator*() const { return set->nodes->node(pos); }
+      iterator& operator++() { pos = set->bits.next(pos + 1); return *this; }
+      iterator operator++(int) { iterator tmp(*this); ++(*this); return tmp; }
+      bool operator==(const iterator& other) const { return pos == other.pos; }
+      bool operator!=(const iterator& other) const { return pos != other.pos; }
+    };
+    using const_iterator = iterator;
+
+    DenseNodeSet() = default;
+    DenseNodeSet(const DenseNodeIndex& _nodes): nodes(&_nodes)
+    { assert(nodes->size() <= Mask::capacity); }
+
+    const Mask& mask() const { return bits; }
+
+    std::pair<iterator, bool> emplace(const Node u)
+    {
+      const size_t i = (*nodes)[u];
+      const bool success = !bits.test(i);
+      bits.set(i);
+      return {iterator(*this, i), success};
+    }
+    size_t erase(const Node u)
+    {
+      const size_t i = (*nodes)[u];
+      const bool result = bits.test(i);
+      bits.reset(i);
+      return result;
+    }
+    size_t count(const Node u) const
+    {
+      const auto iter = nodes->index.find(u);
+      return (iter != nodes->index.end()) && bits.test(iter->second);
+    }
+    size_t size() const { return bits.count(); }
+    bool empty() const { return bits.empty(); }
+
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, Mask::capacity); }
+
+    bool operator==(const DenseNodeSet& other) const { return bits == other.bits; }
+    bool operator!=(const DenseNodeSet& other) const { return bits != other.bits; }
+  };
+
+}
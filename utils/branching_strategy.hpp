@@ -0,0 +1,148 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include "utils.hpp"
+
+/*
+ * when the tree-containment engine cannot reduce the instance any further, it branches on which parent to keep for a reticulation r
+ * above a leaf; a branching strategy decides which of these reticulations to branch on
+ * for each candidate r, the engine collects a BranchInfo (the number of parents of r and what they see) and asks the strategy which
+ * candidate is best; a strategy may also ask the engine to look ahead: then, the engine tries all branches of the best few
+ * candidates, applies the reduction rules in each of them and records how far they got, before asking the strategy again
+ * strategies are stateless, so a single strategy can be shared by all branches of a search (including those running in parallel)
+ */
+
+namespace PT{
+
+  // what we know about a reticulation that we might branch on
+  struct BranchInfo
+  {
+    Node node;
+    size_t num_parents = 0;
+    size_t parents_seeing_noone = 0;          // parents that see no component root
+    size_t parents_seeing_non_leaf_comp = 0;  // parents that see the root of a non-leaf component (of the component DAG)
+    size_t parents_seeing_leaf_comp = 0;      // parents that see the root of a leaf component
+
+    // filled in by the lookahead: the number of branches that failed by the reduction rules alone and
+    // the total number of host edges left in the other branches after applying the reduction rules
+    bool looked_ahead = false;
+    size_t failed_branches = 0;
+    size_t edges_left = 0;
+
+    BranchInfo(const Node& u): node(u) {}
+
+    // the original order of the engine: a candidate is better than another if it has fewer parents seeing noone or,
+    // when tied, if it has fewer parents seeing non-leaf-components or, when still tied, if it has fewer parents seeing leaf-components
+    int cmp(const BranchInfo& other) const
+    {
+      if(parents_seeing_noone < other.parents_seeing_noone) return -1;
+      if(parents_seeing_noone > other.parents_seeing_noone) return 1;
+
+      if(parents_seeing_non_leaf_comp < other.parents_seeing_non_leaf_comp) return -1;
+      if(parents_seeing_non_leaf_comp > other.parents_seeing_non_leaf_comp) return 1;
+
+      if(parents_seeing_leaf_comp < other.parents_seeing_leaf_comp) return -1;
+      if(parents_seeing_leaf_comp > other.parents_seeing_leaf_comp) return 1;
+      return 0;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const BranchInfo& bi)
+    {
+      os << "["<<bi.node<<": "<<bi.num_parents<<" parents, "
+                              <<bi.parents_seeing_noone<<" see noone, "
+                              <<bi.parents_seeing_non_leaf_comp<<" see non-leaf-comp, "
+                              <<bi.parents_seeing_leaf_comp<<" see leaf-comp";
+      if(bi.looked_ahead) os << ", "<<bi.failed_branches<<" branches fail, "<<bi.edges_left<<" edges left";
+      return os << "]";
+    }
+  };
+
+  class BranchingStrategy
+  {
+  public:
+    virtual ~BranchingStrategy() = default;
+
+    virtual const char* name() const = 0;
+
+    // return whether branching on a is preferable to branching on b
+    virtual bool better(const BranchInfo& a, const BranchInfo& b) const = 0;
+
+    // the number of best candidates that the engine should look ahead on before deciding (0 = no lookahead)
+    virtual size_t lookahead() const { return 0; }
+  };
+
+  // the original strategy of the engine: prefer reticulations whose parents see component roots (see BranchInfo::cmp())
+  struct VisibilityBranching: public BranchingStrategy
+  {
+    const char* name() const override { return "visibility"; }
+    bool better(const BranchInfo& a, const BranchInfo& b) const override { return a.cmp(b) < 0; }
+  };
+
+  // prefer reticulations with few parents, to keep the search tree narrow
+  struct FewestParentsBranching: public BranchingStrategy
+  {
+    const char* name() const override { return "fewest-parents"; }
+    bool better(const BranchInfo& a, const BranchInfo& b) const override
+    {
+      if(a.num_parents != b.num_parents) return a.num_parents < b.num_parents;
+      return a.cmp(b) < 0;
+    }
+  };
+
+  // prefer reticulations where the largest fraction of parents see a leaf component: keeping such a parent makes the leaf
+  // visible from the root of that component, so the branch is constrained by the component rules right away
+  struct MostConstrainedBranching: public BranchingStrategy
+  {
+    const char* name() const override { return "most-constrained"; }
+    bool better(const BranchInfo& a, const BranchInfo& b) const override
+    {
+      // compare a.leaf / a.parents with b.leaf / b.parents without dividing
+      const size_t a_score = a.parents_seeing_leaf_comp * b.num_parents;
+      const size_t b_score = b.parents_seeing_leaf_comp * a.num_parents;
+      if(a_score != b_score) return a_score > b_score;
+      return a.cmp(b) < 0;
+    }
+  };
+
+  // look ahead on the best few candidates (in the original order) and prefer those with many branches that fail right away and,
+  // when tied, those whose branches are reduced the most
+  class LookaheadBranching: public BranchingStrategy
+  {
+    const size_t num_candidates;
+  public:
+    LookaheadBranching(const size_t _num_candidates = 4): num_candidates(_num_candidates) {}
+
+    const char* name() const override { return "lookahead"; }
+    size_t lookahead() const override { return num_candidates; }
+    bool better(const BranchInfo& a, const BranchInfo& b) const override
+    {
+      if(a.looked_ahead && b.looked_ahead) {
+        // compare the fractions of failing branches without dividing
+        const size_t a_score = a.failed_branches * b.num_parents;
+        const size_t b_score = b.failed_branches * a.num_parents;
+        if(a_score != b_score) return a_score > b_score;
+        if(a.edges_left != b.edges_left) return a.edges_left < b.edges_left;
+      } else if(a.looked_ahead != b.looked_ahead) return a.looked_ahead;
+      return a.cmp(b) < 0;
+    }
+  };
+
+  inline const std::shared_ptr<const BranchingStrategy>& default_branching_strategy()
+  {
+    static const std::shared_ptr<const BranchingStrategy> strategy = std::make_shared<VisibilityBranching>();
+    return strategy;
+  }
+
+  // return the built-in strategy with the given name
+  inline std::shared_ptr<const BranchingStrategy> make_branching_strategy(const std::string& name)
+  {
+    if(name == "visibility") return default_branching_strategy();
+    if(name == "fewest-parents") return std::make_shared<FewestParentsBranching>();
+    if(name == "most-constrained") return std::make_shared<MostConstrainedBranching>();
+    if(name == "lookahead") return std::make_shared<LookaheadBranching>();
+    throw std::invalid_argument("unknown branching strategy '" + name + "' (choose from visibility, fewest-parents, most-constrained, lookahead)");
+  }
+
+}
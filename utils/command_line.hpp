@@ -24,7 +24,8 @@ namespace PT{
         std::cout << help_message << std::endl;
         exit(EXIT_SUCCESS);
       } else {
-        if(current_arg[0] == '-'){
+        // a lone '-' is a parameter (standing for stdin/stdout), not an option
+        if((current_arg[0] == '-') && (current_arg.size() > 1)){
           const auto mm_iter = description.find(current_arg);
           if(mm_iter != description.end()){
             current_option_vec = &(options[current_arg]);
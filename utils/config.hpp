@@ -4,6 +4,28 @@
 namespace PT{
   namespace config{
 
-    // when merging sorted vectors, switch from linear merge to iterator-queue merge when merging (strictly) more than x vectors
+    // when merging sorted vectors, switch from linear merge to k-way merge when merging (strictly) more than x vectors
     uint8_t vector_queue_merge_threshold = 3;
+
+    // a k-way merge of at most x items in total sorts them instead of running a tournament (see kway_merge.hpp)
+    size_t kway_merge_sort_threshold = 32;
+
+    // when filling a tree-containment table in parallel, subtrees of the guest with less than x nodes are filled sequentially by a single task
+    size_t parallel_subtree_threshold = 1024;
+
+    // the containment pre-filter skips its cluster test for pairs on which this test would cost more than x 64-bit word operations
+    size_t filter_budget = 1ul << 24;
+
+    // a newly created on-disk result cache has x slots (of 32 bytes each)
+    size_t result_cache_slots = 1ul << 20;
+
+    // after editing the host, an incremental containment checker recomputes the tree-component infos for the whole host if the components
+    // around the edits contain more than this fraction of its nodes
+    double incremental_update_fraction = 0.25;
+
+    // when enumerating the trees displayed by a network, remember the fingerprints of the last x distinct trees to skip duplicates
+    size_t displayed_trees_dedup_capacity = 1ul << 18;
+
+    // the scanwidth heuristic solves the pieces of the network with at most x non-suppressible nodes exactly by the DP
+    size_t heuristic_exact_piece_size = 24;
 }}
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <vector>
+#include <utility>
 #include "utils.hpp"
 #include "config.hpp"
 #include "label_matching.hpp"
@@ -9,6 +10,15 @@
 #include "induced_tree.hpp"
 #include "matching.hpp"
 #include "tree_components.hpp"
+#include "thread_pool.hpp"
+#include "trail.hpp"
+#include "worklist.hpp"
+#include "transposition_table.hpp"
+#include "containment_filter.hpp"
+#include "search_budget.hpp"
+#include "branching_strategy.hpp"
+#include "result_cache.hpp"
+#include "kway_merge.hpp"
 
 namespace PT {
  
@@ -45,6 +55,19 @@ namespace PT {
     
     const bool HG_label_match_temporary; // indicate whether the label matching is temporary, that is, whether we can move out of it
 
+    // buffers that are reused for each guest node, so we don't allocate in each step of the DP
+    //NOTE: when filling the table in parallel, each thread uses its own workspace
+    struct Workspace
+    {
+      NodeVec child_poss;
+      KWayMerge<typename NodeList::const_iterator> merger;
+      BipartiteMatching matcher;
+    };
+    Workspace workspace;
+
+    // if we have a thread pool, large enough disjoint subtrees of the guest are treated in parallel
+    std::shared_ptr<WorkStealingPool> pool;
+
   public:
 
     TreeInTreeContainment(const Host& _host,
@@ -64,24 +87,45 @@ namespace PT {
       std::cout << "label matching: "<<*HG_label_match<<"\ntemporary? "<<HG_label_match_temporary<<"\n";
       make_node_infos(_host, node_infos);
       std::cout << node_infos->size() << " node infos: " << *node_infos<<"\n";
+      // if the table is vector-indexed, this makes sure that references to its entries stay valid while we fill it
+      table.reserve(guest.num_nodes());
       construct_base_cases();
     }
 
 
     // lookup where u (guest node) could be hosted; if u is not in the DP table yet, compute the entry
+    //NOTE: entries are computed bottom-up in a postorder of the subtree below u, so we don't recurse (which would overflow the stack for deep trees)
     const NodeList& who_displays(const Node u)
     {
       std::cout << "who displays "<<u<<"? ";
-      const auto [iter, success] = table.try_emplace(u);
-      if(success){
+      const auto iter = table.find(u);
+      if(iter == table.end()){
         std::cout << "\n";
-        compute_possibilities(u, iter->second);
-      } else std::cout << iter->second << "\n";
-      return iter->second;
+        if(pool) {
+          compute_subtree_in_parallel(u);
+        } else {
+          for(const Node x: guest.dfs().postorder(u)) {
+            const auto [x_iter, success] = table.try_emplace(x);
+            if(success) compute_possibilities(x, x_iter->second, workspace);
+          }
+        }
+        return table.at(u);
+      } else {
+        std::cout << iter->second << "\n";
+        return iter->second;
+      }
     }
     
     bool displayed() { return !who_displays(guest.root()).empty(); }
 
+    // fill the table using n threads (see compute_subtree_in_parallel())
+    void set_num_threads(const size_t n)
+    {
+      if(n > 1)
+        pool = std::make_shared<WorkStealingPool>(n - 1);
+      else pool.reset();
+    }
+
   protected:
     // in the subtree induced by the child possibilities, we'll need to keep track of which child of u can be displayed by one of our own children
     using MatchingPossibilities = HashMap<Node, std::unordered_bitset>;
@@ -125,10 +169,89 @@ namespace PT {
       }
     }
     
-    void compute_possibilities(const Node u, NodeList& poss)
+    static Workspace& thread_workspace()
+    {
+      static thread_local Workspace ws;
+      return ws;
+    }
+
+    // compute the table entries of all nodes below u that are not in the table yet, as a dependency-DAG of tasks:
+    // subtrees with less than config::parallel_subtree_threshold new entries are filled sequentially by a single task, and
+    // each larger node is treated by a task of its own as soon as the last of its children is done
+    //NOTE: all new entries are created before any task starts, so the table itself is not modified while tasks are running
+    //NOTE: the tasks compute the same entries as the sequential engine, just in a different order
+    void compute_subtree_in_parallel(const Node u)
+    {
+      // step 1: in postorder, create the new entries and count the number of new entries below each node
+      //NOTE: u's subtree may be much smaller than the guest, so we use hash maps instead of maps indexed by the nodes
+      HashMap<Node, size_t> new_below;
+      NodeVec large_nodes;
+      for(const Node x: guest.dfs().postorder(u)) {
+        if(table.try_emplace(x).second) {
+          size_t x_size = 1;
+          for(const Node y: guest.children(x)) {
+            const auto y_iter = new_below.find(y);
+            if(y_iter != new_below.end()) x_size += y_iter->second;
+          }
+          new_below.try_emplace(x, x_size);
+          if(x_size >= config::parallel_subtree_threshold) large_nodes.push_back(x);
+        }
+      }
+      if(new_below.empty()) return;
+      std::cout << "filling table for "<<new_below.size()<<" nodes below "<<u<<" in parallel ("<<large_nodes.size()<<" large nodes)\n";
+
+      // step 2: for each large node, count the children whose entries are still to be computed
+      HashMap<Node, size_t> large_index;
+      std::vector<std::atomic<size_t>> pending_children(large_nodes.size());
+      for(size_t i = 0; i < large_nodes.size(); ++i){
+        large_index.try_emplace(large_nodes[i], i);
+        size_t num_pending = 0;
+        for(const Node y: guest.children(large_nodes[i])) num_pending += test(new_below, y);
+        pending_children[i] = num_pending;
+      }
+      const auto is_large = [&](const Node x) { return test(large_index, x); };
+
+      TaskGroup tasks(*pool);
+      // when x is done, tell its parent; if x was the last child that the parent was waiting for, then treat the parent
+      std::function<void(const Node)> finished = [&](const Node x) {
+        if(x != u) {
+          const Node px = guest.parent(x);
+          const size_t px_index = large_index.at(px);
+          if(--pending_children[px_index] == 0)
+            tasks.run([&, px]{
+                compute_possibilities(px, table.at(px), thread_workspace());
+                finished(px);
+              });
+        }
+      };
+      // step 3: start a task for each small subtree directly below a large node (or u itself if it is small)
+      //         as well as for each large node that is not waiting for any of its children
+      for(const Node x: guest.dfs().preorder(u)) {
+        const auto x_iter = new_below.find(x);
+        if(x_iter == new_below.end()) continue;
+        if(!is_large(x)) {
+          if((x == u) || is_large(guest.parent(x)))
+            tasks.run([&, x]{
+                Workspace& ws = thread_workspace();
+                for(const Node y: guest.dfs().postorder(x))
+                  if(test(new_below, y)) compute_possibilities(y, table.at(y), ws);
+                finished(x);
+              });
+        } else if(pending_children[large_index.at(x)] == 0)
+          tasks.run([&, x]{
+              compute_possibilities(x, table.at(x), thread_workspace());
+              finished(x);
+            });
+      }
+      tasks.wait();
+    }
+
+    //NOTE: the entries of all children of u must have been computed before
+    void compute_possibilities(const Node u, NodeList& poss, Workspace& ws)
     {
       // step 1: get the subtree of host induced by the nodes that the children map to
-      const NodeVec child_poss = merge_child_poss(u);
+      merge_child_poss(u, ws);
+      const NodeVec& child_poss = ws.child_poss;
       if(!child_poss.empty()){
         if(guest.out_degree(u) > 1){
           std::cout << "building tree induced by "<<child_poss<<"\n";
@@ -138,7 +261,7 @@ namespace PT {
             // step 2: find all nodes v such that each child of u has a possibility that is seen by a distinct leaf of v
             // register the possibilities for all but one child of u
             for(const Node u_child: guest.children(u)){
-              for(Node v_child: who_displays(u_child)){
+              for(Node v_child: table.at(u_child)){
                 // move upwards from v_child until we reach a node that's already seen a possibility for u_child
                 while(v_child != induced_subhost.root()){
                   const Node v_parent = induced_subhost.parent(v_child);
@@ -153,7 +276,7 @@ namespace PT {
               const auto& v_infos = induced_subhost[v];
               if(v_infos.nodes_for_poss.size() == guest.out_degree(u)){ // if all children of u have a child of u that can display them
                 std::cout << "making bipartite matching from "<<v_infos.nodes_for_poss<<"\n";
-                if(perfect_child_matching(v_infos.nodes_for_poss)){ // if each child of v can be displayed by a different child of u
+                if(perfect_child_matching(v_infos.nodes_for_poss, ws.matcher)){ // if each child of v can be displayed by a different child of u
                   // H_v displays G_u \o/ - register and mark all ancestors uninteresting, so we don't run matching on them in the future
                   poss.push_back(v);
                   // if someone else already marked v unintersting, all ancestors are already marked as well
@@ -164,69 +287,45 @@ namespace PT {
             // make sure the nodes are in the correct order
             std::flexible_sort(poss.begin(), poss.end(), sort_by_order);
           } else poss.clear(); // if the induced tree is edgeless but there are at least 2 children of u in guest, then u is not displayed
-        } else append(poss, child_poss); // if u has a single child, then u maps where this child maps
+        } else append(poss, std::as_const(child_poss)); // if u has a single child, then u maps where this child maps
       } else poss.clear(); // if no child of u can be mapped, then u cannot be mapped either
 
       std::cout << "found that "<< u << " is displayed at "<<poss<<"\n";
     }
 
     // return whether all children of u can be matched using the possibilities given
-    bool perfect_child_matching(const MatchingPossibilities& poss)
+    bool perfect_child_matching(const MatchingPossibilities& poss, BipartiteMatching& matcher) const
     {
-      return bipartite_matching<Node, MatchingPossibilities>(poss).maximum_matching().size() == poss.size();
+      matcher.clear(poss.size());
+      size_t u_child_idx = 0;
+      for(const auto& [u_child, v_children]: poss) {
+        for(const Node v_child: v_children) matcher.add_edge(u_child_idx, v_child);
+        ++u_child_idx;
+      }
+      return matcher.has_perfect_matching();
     }
 
-    // merge the mapping possibilities of all childs into one vector; unless one of the children cannot be mapped, in which case return the empty vector
-    NodeVec merge_child_poss(const Node u)
+    // merge the mapping possibilities of all childs into child_poss; unless one of the children cannot be mapped, in which case, leave child_poss empty
+    //NOTE: the lists are sorted by order number, so we merge them by order number, looking up the order number of each node only once
+    void merge_child_poss(const Node u, Workspace& ws)
     {
+      NodeVec& child_poss = ws.child_poss;
       // if u is a leaf, it should be managed by the base case, unless its label is not in the host, in which case it's not displayed
-      NodeVec poss;
+      child_poss.clear();
       if(!guest.is_leaf(u)){
         std::cout << "merging possibilities of "<<guest.children(u)<<"\n";
-        // for degree up to x, merge the child possibilities by linear "inplace_merge", otherwise, merge via iterator-queue in O(n log deg)
-        if(guest.out_degree(u) > config::vector_queue_merge_threshold){
-          using NodeIter = std::auto_iter<typename NodeList::const_iterator>;
-          // NOTE: priority_queue outputs the LARGEST element first, so we'll have to reverse sort_by_order by swapping its arguments
-          const auto sort_iter_by_order = [&](const auto& a, const auto& b) -> bool {  return sort_by_order(*b, *a); };
-          
-          std::priority_queue<NodeIter, std::vector<NodeIter>, decltype(sort_iter_by_order)> iter_queue(sort_iter_by_order);
-          size_t total_size = 0;
-          // for each child v of u, add an auto iter to its possibility list
-          for(const Node v: guest.children(u)){
-            const auto& child_poss = who_displays(v);
-            if(!child_poss.empty()){
-              iter_queue.push(child_poss);
-              total_size += child_poss.size();
-            } else {
-              // if v cannot be displayed, then u cannot be displayed, so return the empty possibility vector
-              poss.clear();
-              return poss;
-            }
-          }
-          poss.reserve(total_size);
-          while(!iter_queue.empty()) {
-            auto next_iter = iter_queue.top(); iter_queue.pop();
-            poss.push_back(*next_iter);
-            if(++next_iter) iter_queue.push(next_iter);
-          }
-        } else {
-          for(const Node v: guest.children(u)) {
-            const NodeList& v_poss = who_displays(v);
-            if(!v_poss.empty()){
-              const size_t old_size = poss.size();
-              std::cout << "merging "; for(const auto& x: poss) std::cout << x <<":"<<node_infos->at(x).order_number<<" ";
-              std::cout << "\t&\t";  for(const auto& x: v_poss) std::cout << x <<":"<<node_infos->at(x).order_number<<" "; std::cout << "\n";
-              
-              poss.insert(poss.end(), v_poss.begin(), v_poss.end());
-              std::inplace_merge(poss.begin(), poss.begin() + old_size, poss.end(), sort_by_order);
-            } else {
-              poss.clear();
-              return poss;
-            }
+        for(const Node v: guest.children(u)){
+          const NodeList& v_poss = table.at(v);
+          if(!v_poss.empty()){
+            ws.merger.add_run(v_poss);
+          } else {
+            // if v cannot be displayed, then u cannot be displayed, so leave the possibility vector empty
+            ws.merger.clear();
+            return;
           }
         }
+        ws.merger.merge_into(child_poss, [this](const Node x) { return node_infos->at(x).order_number; });
       }
-      return poss;
     }
 
 
@@ -370,8 +469,8 @@ namespace PT {
     using Parent = ContainmentReduction<Containment>;
     using Parent::Parent;
 
-    HashSet<Node> node_queue;
-    void add(const Node x) { append(node_queue, x); std::cout << "adding node "<<x<<" to queue of "<<reduction_name()<<", now: "<<node_queue<<"\n"; }
+    NodeWorklist node_queue;
+    void add(const Node x) { node_queue.push(x); std::cout << "adding node "<<x<<" to queue of "<<reduction_name()<<", now: "<<node_queue<<"\n"; }
     
     virtual std::string reduction_name() const { return "reduction with queue"; }
   };
@@ -412,19 +511,24 @@ namespace PT {
     {
       bool result = false;
       while(!node_queue.empty()){
-        const Node x = value_pop_back(node_queue);
+        const Node x = node_queue.pop();
         if(host.has_node(x) && (host.out_degree(x) == 1) && contract_reti(x))
           result = true;
       }
       return result;
     }
 
+    // queue x if it is an out-degree-1 node above another out-degree-1 node
+    void add_if_mergeable(const Node x)
+    {
+      if((host.out_degree(x) == 1) && (host.out_degree(host.any_child(x)) == 1))
+        Parent::add(x);
+    }
+
     // prepare first round of reticulations to merge
     void init_queue()
     {
-      for(const Node x: host.nodes())
-        if((host.out_degree(x) == 1) && (host.out_degree(host.any_child(x)) == 1))
-          Parent::add(x);
+      for(const Node x: host.nodes()) add_if_mergeable(x);
     }
 
     virtual std::string reduction_name() const { return "reticulation merger"; }
@@ -517,16 +621,23 @@ namespace PT {
 
     void init_queue()
     {
-      for(const auto uv: contain.HG_label_match)
+      for(const auto& uv: contain.HG_label_match)
         Parent::add(uv.second.first);
     }
 
+    // queue the host leaf u unless it is obvious that simple_cherry_reduction_from() will not do anything for it
+    void add_if_candidate(const Node u)
+    {
+      if(host.has_label(u) && (host.in_degree(u) == 1) && (host.in_degree(host.parent(u)) <= 1))
+        Parent::add(u);
+    }
+
     bool simple_cherry_reduction()
     {
       std::cout << "\tCHERRY: applying reduction...\n";
       bool result = false;
       while(!node_queue.empty()){
-        const Node u = value_pop_back(node_queue);
+        const Node u = node_queue.pop();
         if(host.has_node(u) && host.has_label(u))
           if(simple_cherry_reduction_from(contain.HG_label_match.find(host.label(u))))
             result = true;
@@ -561,6 +672,7 @@ namespace PT {
         contain.HG_match.match_nodes(pu, v, uv_label_iter);
         return true;
       } else {
+        bool removed_edges = false;
         for(auto iter = puC.begin(); iter != puC.end();){
           Node x = *iter; ++iter;
           Node y = x;
@@ -571,14 +683,21 @@ namespace PT {
           while(host.out_degree(x) == 1) x = host.any_child(x);
           // we've arrived at a label below pu that is not below pv, so pu-->x will never be in an embedding of guest in host!
           if(host.has_label(y) && !seen.erase(host.label(y))) {
+            // if pu is the only way into y, then the image of pv must be pu, so y would have to be a child of pv
+            if(host.in_degree(y) == 1) {
+              std::cout << "\tCHERRY: "<<y<<" can only be reached via "<<pu<<", but "<<host.label(y)<<" is not below "<<pv<<"\n";
+              return contain.failed = true;
+            }
             host.remove_edge(z, y);
             contain.comp_info.inherit_root(y); // update the component info of y
             contain.suppress.add(z);
             contain.suppress.add(y);
+            removed_edges = true;
           }
         }
+        //NOTE: if we removed edges, then we have to report a change, so that the suppression queue is processed before any other rule
+        if(!seen.empty()) return removed_edges;
       }
-      if(!seen.empty()) return false;
 
       std::cout << "\tCHERRY: found (reticulated) cherry at "<<pu<<" (host) and "<<pv<<" (guest)\n";
       // step 1: fix visibility labeling to u, because the leaf that pu's root is visible from may not survive the cherry reduction (but u will)
@@ -703,10 +822,24 @@ namespace PT {
       } else return cDAG.root();
     }
 
+    // get a leaf of the component-DAG that is visible from a leaf of the host (or NoNode if there is no such leaf)
+    //NOTE: lowest components are always half-eligible, so this saves us from computing path profiles for the whole component-DAG
+    //NOTE: since the postorder is lazy, this is cheap if the first lowest component we encounter is visible
+    Node get_visible_lowest_component_root()
+    {
+      if(!cDAG.edgeless()) {
+        for(const Node u: cDAG.dfs().postorder())
+          if(cDAG.is_leaf(u) && (host[u].visible_leaf != NoNode)) return u;
+        return NoNode;
+      } else return cDAG.root();
+    }
+
     // visible tree-component reduction: find a lowest visible tree component C and reduce it in O(|C|) time; return if network/tree changed
-    bool apply()
+    //NOTE: if lowest_first is set, we first try to find a lowest visible component before computing eligibility for the whole component-DAG
+    bool apply(const bool lowest_first)
     {
-      const Node rt = get_eligible_component_root();
+      Node rt = lowest_first ? get_visible_lowest_component_root() : NoNode;
+      if(rt == NoNode) rt = get_eligible_component_root();
       if(rt != NoNode){
         std::cout << "tree-component rule with eligible node "<< rt <<" ("<<host[rt]<<") on tree-component DAG:\n"<<cDAG<<"\n";
         const Node vis_leaf = host[rt].visible_leaf;
@@ -720,6 +853,7 @@ namespace PT {
         return true;
       } else return false;
     } 
+    bool apply() { return apply(false); }
 
     virtual std::string reduction_name() const { return "visible component rule"; }
   };
@@ -747,7 +881,7 @@ namespace PT {
     {
       if(node_queue.empty()) return false;
       while(!node_queue.empty())
-        clean_up_node(value_pop_back(node_queue), recursive, apply_reti_reduction);
+        clean_up_node(node_queue.pop(), recursive, apply_reti_reduction);
       return true;
     }
 
@@ -870,7 +1004,7 @@ namespace PT {
         for(const Node w: host.parents(host_x)) contain.suppress.add(w);
         host.suppress_node(host_x);
         guest.suppress_node(x);
-        HG_label_match.erase(HG_match_iter);
+        contain.erase_label_match(HG_match_iter);
       }
     }
 
@@ -900,7 +1034,7 @@ namespace PT {
           // if the node v in guest with the same label as x has not been removed before, it means that v can never be displayed!
           const auto HG_iter = HG_label_match.find(host.label(rt));
           if(guest.has_node(HG_iter->second.second)) contain.failed = true;
-          HG_label_match.erase(HG_iter);
+          contain.erase_label_match(HG_iter);
         }
         if(host[rt].comp_root == rt) {
           assert(contain.comp_info.comp_DAG.has_node(rt));
@@ -952,6 +1086,24 @@ namespace PT {
 
 
 
+  template<class Host, class Guest, bool leaf_labels_only>
+  class TreeInNetBatchContainment;
+  template<class Host, class Guest, bool leaf_labels_only>
+  class IncrementalContainment;
+
+  // a flag that is raised as soon as one of a set of sibling branches found an embedding, telling the others to stop searching
+  //NOTE: a branch is also cancelled if any of its ancestor branchings has been cancelled
+  struct BranchCancellation
+  {
+    const BranchCancellation* const parent = nullptr;
+    std::atomic<bool> raised = false;
+
+    BranchCancellation(const BranchCancellation* _parent = nullptr): parent(_parent) {}
+
+    void raise() { raised.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return raised.load(std::memory_order_relaxed) || (parent && parent->cancelled()); }
+  };
+
   // a containment checker, testing if a single-labelled host-network contains a single-labeled guest tree
   //NOTE: if an invisible tree component is encountered, we will branch on which subtree to display in the component
   //NOTE: this can be used to solve multi-labeled host networks: just add a reticulation for each multiply occuring label
@@ -970,6 +1122,9 @@ namespace PT {
     friend class VisibleComponentRule<TreeInNetContainment>;
     friend class NodeSuppresser<TreeInNetContainment>;
     friend class HostGuestMatch<TreeInNetContainment>;
+    friend class TreeInNetBatchContainment<Host, Guest, leaf_labels_only>;
+    friend class IncrementalContainment<Host, Guest, leaf_labels_only>;
+    template<class, class> friend class TrailLog;
 
     // we'll work with mutable copies of the network & tree, which can be given by move
     using RWHost = CompatibleRWNetwork<Host, ComponentData>;
@@ -989,6 +1144,36 @@ namespace PT {
 
     bool failed;
 
+    // if we have a thread pool, sibling branches will be explored in parallel
+    std::shared_ptr<WorkStealingPool> pool;
+    // the cancellation flag of the branching that created us (if any)
+    const BranchCancellation* cancellation = nullptr;
+
+    // if we have an undo-trail, branches are explored in-place and rolled back, instead of exploring them on copies of *this
+    //NOTE: branches that are explored in parallel still work on copies (but they use their own trails for their sub-branches)
+    std::unique_ptr<UndoTrail> trail;
+    TrailLogHolder<TrailLog<TreeInNetContainment, typename LabelMatching::value_type>> label_log;
+
+    // a table of results of sub-instances that we've already decided (shared among all branches)
+    std::shared_ptr<TranspositionTable<bool>> memo;
+
+    // the resources that the search may use (shared among all branches) and the number of branchings above us
+    std::shared_ptr<SearchBudget> budget;
+    size_t depth = 0;
+
+    // the strategy choosing the reticulation to branch on (shared among all branches)
+    std::shared_ptr<const BranchingStrategy> strategy = default_branching_strategy();
+
+    // the nodes of host and guest that have been modified since we last scheduled the reduction rules for them
+    //NOTE: instead of checking all nodes in each round of rule-application, we only check the surroundings of these nodes
+    struct ModifiedNodes: public ModificationListener
+    {
+      NodeWorklist nodes;
+      void modifying(const Node x) override { nodes.push(x); }
+    };
+    ModifiedNodes host_modified;
+    ModifiedNodes guest_modified;
+
     // reduction rules
     ReticulationMerger<TreeInNetContainment> reti_merge;
     TriangleReducer<TreeInNetContainment> triangle_rule;
@@ -1019,19 +1204,47 @@ namespace PT {
       HG_match(*this)
     { init(); }
 
+    // construct from a host that has been preprocessed by a TreeInNetBatchContainment: we copy the host, its component infos and
+    // the host-side of the label matching and we only have to match the guest labels against it
+    template<class _Guest>
+    TreeInNetContainment(const RWHost& _host, const ComponentInfos& _comp_info, const LabelMatching& host_labels, _Guest&& _guest):
+      host(_host),
+      guest(std::forward<_Guest>(_guest)),
+      HG_label_match(host_labels),
+      comp_info(_comp_info, host),
+      failed(false),
+      reti_merge(*this),
+      triangle_rule(*this),
+      cherry_rule(*this),
+      visible_comp(*this),
+      suppress(*this),
+      HG_match(*this)
+    {
+      HG_label_match.match_second(guest.nodes_labeled());
+      init();
+    }
+
     TreeInNetContainment(const TreeInNetContainment& tc):
       host(tc.host),
       guest(tc.guest),
       HG_label_match(tc.HG_label_match),
       comp_info(tc.comp_info, host),
       failed(tc.failed),
+      pool(tc.pool),
+      cancellation(tc.cancellation),
+      memo(tc.memo),
+      budget(tc.budget),
+      depth(tc.depth),
+      strategy(tc.strategy),
+      host_modified(tc.host_modified),
+      guest_modified(tc.guest_modified),
       reti_merge(*this),
       triangle_rule(*this),
       cherry_rule(*this),
       visible_comp(*this),
       suppress(*this),
       HG_match(*this)
-    {}
+    { listen(); }
 
     TreeInNetContainment(TreeInNetContainment&& tc):
       host(std::move(tc.host)),
@@ -1039,27 +1252,98 @@ namespace PT {
       HG_label_match(std::move(tc.HG_label_match)),
       comp_info(std::move(tc.comp_info), host),
       failed(std::move(tc.failed)),
+      pool(std::move(tc.pool)),
+      cancellation(tc.cancellation),
+      memo(std::move(tc.memo)),
+      budget(std::move(tc.budget)),
+      depth(tc.depth),
+      strategy(std::move(tc.strategy)),
+      host_modified(std::move(tc.host_modified)),
+      guest_modified(std::move(tc.guest_modified)),
       reti_merge(*this),
       triangle_rule(*this),
       cherry_rule(*this),
       visible_comp(*this),
       suppress(*this),
       HG_match(*this)
-    {}
+    { listen(); }
 
     // ***************************************
     //              Maintenance
     // ***************************************
 
+    // have host and guest tell us which nodes they modify
+    //NOTE: host and guest do not pass this on to their copies, so each copy of *this has to call this
+    void listen()
+    {
+      host.set_listener(&host_modified);
+      guest.set_listener(&guest_modified);
+    }
+
+    // queue the host leaves whose cherries may have changed since a modification of the host node x
+    //NOTE: a cherry-check for a leaf u with parent pu looks at the children of pu and follows paths of out-degree-1 nodes from them,
+    //      so we queue the leaf-children of x and of each node that reaches x via a path of out-degree-1 nodes
+    void schedule_cherries_around_host_node(const Node x)
+    {
+      NodeVec to_visit = {x};
+      while(!to_visit.empty()) {
+        const Node y = value_pop_back(to_visit);
+        if(host.is_leaf(y)) cherry_rule.add_if_candidate(y);
+        for(const Node z: host.children(y))
+          if(host.is_leaf(z)) cherry_rule.add_if_candidate(z);
+        if(host.out_degree(y) <= 1)
+          for(const Node z: host.parents(y)) to_visit.push_back(z);
+      }
+    }
+
+    // queue the host leaves whose cherries may have changed since a modification of the guest node x
+    //NOTE: a cherry-check for a leaf v with parent pv looks at the children of pv, so we queue the (host-leaves corresponding to) the
+    //      leaf-children of x and its parent
+    void schedule_cherries_around_guest_node(const Node x)
+    {
+      const auto schedule_guest_leaf = [&](const Node y) {
+        const auto uv_iter = HG_label_match.find(guest.label(y));
+        if(uv_iter != HG_label_match.end()) cherry_rule.add_if_candidate(uv_iter->second.first);
+      };
+      if(guest.is_leaf(x)) schedule_guest_leaf(x);
+      for(const Node y: guest.children(x))
+        if(guest.is_leaf(y)) schedule_guest_leaf(y);
+      for(const Node px: guest.parents(x))
+        for(const Node y: guest.children(px))
+          if(guest.is_leaf(y)) schedule_guest_leaf(y);
+    }
+
+    // queue the candidates of the cherry rule and the reticulation merger around all nodes modified since the last call
+    void schedule_modified()
+    {
+      while(!host_modified.nodes.empty()) {
+        const Node x = host_modified.nodes.pop();
+        if(host.has_node(x)) {
+          reti_merge.add_if_mergeable(x);
+          for(const Node px: host.parents(x)) reti_merge.add_if_mergeable(px);
+          schedule_cherries_around_host_node(x);
+        }
+      }
+      while(!guest_modified.nodes.empty()) {
+        const Node x = guest_modified.nodes.pop();
+        if(guest.has_node(x)) schedule_cherries_around_guest_node(x);
+      }
+    }
+
     void apply_rules()
     {
       std::cout << "\n ===== REDUCTION RULES ======\n\n";
-      reti_merge.init_queue();
+      // if all tree components of the host are visible (f.ex. in tree-child networks), then the visible-component rule always applies
+      // to any lowest tree component, so we will never have to branch and we don't need to check eligibility of the whole component-DAG
+      const bool components_visible = comp_info.all_components_visible();
+      if(components_visible) std::cout << "all tree components are visible, no branching necessary\n";
+      schedule_modified();
       reti_merge.apply();
 
       // if, at some point, there are only 2 leaves left, then simply say 'yes'
-      while(!failed && (HG_label_match.size() > 2)) {
+      while(!failed && !cancelled() && (HG_label_match.size() > 2)) {
         std::cout << "\nrestart rule-application...\n";
+        if(budget) budget->count_reduction_round();
         std::cout << "host:\n" << host << "guest:\n" << guest << "comp-DAG:\n"<<comp_info.comp_DAG<<"\n";
         std::cout << "label matching: "<<HG_label_match<<"\n";
         std::cout << "comp-info: "; for(const auto& x: host.get_node_data()) std::cout << x <<"\n";
@@ -1068,12 +1352,12 @@ namespace PT {
         // not necessary to apply each time, clean_up_node will call it when appropriate
         //if(triangle_rule.apply()) continue;
       
-        cherry_rule.init_queue();
+        schedule_modified();
         if(cherry_rule.apply()) continue;
         
-        if(visible_comp.apply()) continue;
+        if(visible_comp.apply(components_visible)) continue;
 
-        reti_merge.init_queue();
+        schedule_modified();
         if(reti_merge.apply()) continue;
         
         break;
@@ -1085,6 +1369,7 @@ namespace PT {
     // initialization and early reductions
     void init()
     {
+      listen();
       if(!clean_up_labels()){
         std::cout << "initial comp-root DAG:\n"<<comp_info.comp_DAG<<"\n";
         std::cout << "initial comp-info: "; for(const auto& x: host.get_node_data()) std::cout << x <<"\n";
@@ -1093,19 +1378,61 @@ namespace PT {
         if(comp_info.comp_DAG.edgeless() && !host.edgeless()) {
           // NOTE: if comp_info.comp_DAG is edgeless, then its root may not correspond to the root of host
           const Node tc_root = comp_info.comp_DAG.root();
-          comp_info.comp_DAG.add_child(tc_root, host.root());
-          comp_info.comp_DAG.remove_node(tc_root);
+          if(tc_root != host.root()) {
+            comp_info.comp_DAG.add_child(tc_root, host.root());
+            comp_info.comp_DAG.remove_node(tc_root);
+          }
         }
 
+        // the first time around, all nodes are candidates for the rules, later on, only the surroundings of modified nodes are
+        host_modified.nodes.clear();
+        guest_modified.nodes.clear();
+        reti_merge.init_queue();
+        cherry_rule.init_queue();
+
         // apply all reduction rules
         apply_rules();
 
-        // if the comp_DAG is edgeless, then visible-component reduction must have applied (unless the loop broke for the 2-label-case)
-        assert(!comp_info.comp_DAG.edgeless() || host.edgeless() || (HG_label_match.size() <= 2));
+        // if the comp_DAG is edgeless, then visible-component reduction must have applied (unless the loop broke for the 2-label-case or
+        // because the guest turned out not to be displayed)
+        assert(failed || !comp_info.comp_DAG.edgeless() || host.edgeless() || (HG_label_match.size() <= 2));
       }
       std::cout << "done initializing Tree-in-Net containment checker; failed? "<<failed<<"\n";
     }
 
+    // remove an entry from the label matching, recording it on the undo-trail (if any)
+    LM_Iter erase_label_match(const LM_Iter& iter)
+    {
+      if(label_log) label_log->save(*iter);
+      return HG_label_match.erase(iter);
+    }
+
+    void restore_from_trail(typename LabelMatching::value_type&& entry) { HG_label_match.insert(std::move(entry)); }
+
+    // a fingerprint of the current (reduced) host, guest, and the labels that are still to be matched
+    Fingerprint instance_fingerprint() const
+    {
+      Fingerprint fp = structural_fingerprint(host, leaf_labels_only);
+      fp += structural_fingerprint(guest, leaf_labels_only);
+      Fingerprint labels_fp = {HG_label_match.size(), 0};
+      const std::hash<typename LabelMatching::key_type> label_hash;
+      for(const auto& label: firsts(HG_label_match)) {
+        const size_t lh = label_hash(label);
+        labels_fp.first += uint64_hash(lh);
+        labels_fp.second += uint64_hash(lh ^ 0x85ebca6b);
+      }
+      return fp += labels_fp;
+    }
+
+    void clear_reduction_queues()
+    {
+      reti_merge.node_queue.clear();
+      cherry_rule.node_queue.clear();
+      suppress.node_queue.clear();
+      host_modified.nodes.clear();
+      guest_modified.nodes.clear();
+    }
+
     // remove labels present in only one of N and T, remove whether we already failed
     bool clean_up_labels()
     {
@@ -1118,7 +1445,7 @@ namespace PT {
           // this label occurs only in the host, but not in the guest, so we can simply remove it, along with the entry in the label matching
           std::cout << "removing label "<<label_iter->first<<" from the host since it's not in the guest\n";
           host.remove_upwards(uv.first);
-          label_iter = HG_label_match.erase(label_iter);
+          label_iter = erase_label_match(label_iter);
         } else ++label_iter;
       }
       return false;
@@ -1130,47 +1457,86 @@ namespace PT {
     //               branching
     // ***************************************
 
-    // in our data structure, we map each target reticulation to 3 numbers: (1) #parents not seeing a comp root,
-    // (2) #parents seeing a non-leaf comp-root, (3) #parents seeing a leaf-comp-root
-    struct BranchInfo
+    // return the BranchInfo of the reticulation pu above a leaf
+    BranchInfo get_branch_info(const Node pu) const
     {
-      Node node;
-      size_t parents_seeing_noone = 0;
-      size_t parents_seeing_non_leaf_comp = 0;
-      size_t parents_seeing_leaf_comp = 0;
-
-      BranchInfo(const Node& u): node(u) {}
-      // a branchinfo is "better" than another if it has fewer parents seeing noone or,
-      // when tied, if it has fewer parents not seeing non-leaf-components or,
-      // when still tied, if it has fewer parents seeing leaf-components
-      int cmp(const BranchInfo& other) const
-      {
-        if(parents_seeing_noone < other.parents_seeing_noone) return -1;
-        if(parents_seeing_noone > other.parents_seeing_noone) return 1;
-
-        if(parents_seeing_non_leaf_comp < other.parents_seeing_non_leaf_comp) return -1;
-        if(parents_seeing_non_leaf_comp > other.parents_seeing_non_leaf_comp) return 1;
-
-        if(parents_seeing_leaf_comp < other.parents_seeing_leaf_comp) return -1;
-        if(parents_seeing_leaf_comp > other.parents_seeing_leaf_comp) return 1;
-        return 0;
+      BranchInfo pu_info(pu);
+      pu_info.num_parents = host.in_degree(pu);
+      for(const Node x: host.parents(pu)) {
+        const Node rt_x = host[x].comp_root;
+        std::cout << "considering comp-root "<<rt_x <<" ("<<host[x]<<") of "<<pu<<"\n";
+        if(rt_x != NoNode){
+          if(comp_info.comp_DAG.is_leaf(rt_x))
+            pu_info.parents_seeing_leaf_comp++;
+          else
+            pu_info.parents_seeing_non_leaf_comp++;
+        } else pu_info.parents_seeing_noone++;
       }
-      bool operator<(const BranchInfo& other) const { return cmp(other) < 0; }
-      bool operator>(const BranchInfo& other) const { return cmp(other) > 0; }
-      bool operator<=(const BranchInfo& other) const { return cmp(other) <= 0; }
-      bool operator>=(const BranchInfo& other) const { return cmp(other) >= 0; }
-      bool operator==(const BranchInfo& other) const { return cmp(other) == 0; }
+      return pu_info;
+    }
 
-      friend std::ostream& operator<<(std::ostream& os, const BranchInfo& bi)
-      {
-        return os << "["<<bi.node<<": "<<bi.parents_seeing_noone<<" see noone, "
-                                       <<bi.parents_seeing_non_leaf_comp<<" see non-leaf-comp, "
-                                       <<bi.parents_seeing_leaf_comp<<" see leaf-comp]";
+    // try each branch of the candidate and record how many of them fail by the reduction rules alone and how many host edges the
+    // others leave (see BranchingStrategy::lookahead())
+    void look_ahead(BranchInfo& info) const
+    {
+      for(const Node v: host.parents(info.node)) {
+        TreeInNetContainment sub_checker(*this);
+        sub_checker.force_parent(info.node, v);
+        sub_checker.apply_rules();
+        if(sub_checker.failed) ++info.failed_branches; else info.edges_left += sub_checker.host.num_edges();
       }
-    };
-
+      info.looked_ahead = true;
+    }
 
+    // return the reticulation to branch on, or NoNode if the lookahead showed that all its branches fail
+    Node choose_branching()
+    {
+      // We would like to make visible as many leaf-components as possible on each branch, so we only branch on invisible
+      // reticulations r above leaves and let the strategy choose among them.
+      // For each leaf z that does not see a non-leaf-component root, get the reticulation above z (if z does not have
+      // a reticulation parent, then cherry reduction must be applicable to it)
+      std::vector<BranchInfo> candidates;
+      for(const auto& HG_leaf_pair: seconds(HG_label_match)){
+        const Node u = HG_leaf_pair.first;
+        const Node rt_u = host[u].comp_root;
+        if(rt_u == NoNode) {
+          std::cout << u << " sees noone\n" << u <<"'s parents are "<<host.parents(u)<<"\n";
+          // if u does not see any component-root, then its parent is necessarily a reticulation (since cherry-reduction is applied continuously)
+          assert(host.in_degree(u) == 1);
+          const Node pu = host.parent(u);
+          assert(host.out_degree(pu) == 1);
+          assert(host.in_degree(pu) > 1);
+          // the parent reticulation cannot see a tree-component since u would see it too
+          assert(host[pu].comp_root == NoNode);
+          candidates.push_back(get_branch_info(pu));
+          std::cout << "branch-info for "<<pu<<": "<<candidates.back()<<"\n";
+        } else std::cout << rt_u << " is visible from "<<u<<" so one of the implied branches does not make progress. Ignoring "<<u<<"...\n";
+      }
+      std::cout << "found "<<candidates.size() <<" branching opportunities\n";
+      assert(!candidates.empty());
+
+      const auto better = [this](const BranchInfo& a, const BranchInfo& b) { return strategy->better(a, b); };
+      const size_t num_lookahead = std::min(strategy->lookahead(), candidates.size());
+      if((num_lookahead > 0) && (candidates.size() > 1)) {
+        std::partial_sort(candidates.begin(), candidates.begin() + num_lookahead, candidates.end(), better);
+        for(size_t i = 0; i < num_lookahead; ++i) {
+          BranchInfo& info = candidates[i];
+          look_ahead(info);
+          std::cout << "looked ahead on "<<info<<"\n";
+          // if all branches fail, then the guest is not displayed
+          if(info.failed_branches == info.num_parents) return NoNode;
+        }
+      }
+      const BranchInfo& best = *std::min_element(candidates.begin(), candidates.end(), better);
+      std::cout << "best branching ("<<strategy->name()<<"): "<< best << "\n";
+      return best.node;
+    }
 
+    // register a node of the search tree (see SearchBudget::count_node())
+    void count_node(const std::chrono::steady_clock::time_point start, const bool branched) const
+    {
+      if(budget) budget->count_node(depth, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), branched);
+    }
 
   public:
 
@@ -1201,75 +1567,299 @@ namespace PT {
 
     bool displayed()
     {
-      if(failed) return false;
+      if(failed || cancelled()) return false;
+      const auto start = std::chrono::steady_clock::now();
       apply_rules();
-      if(failed) return false;
+      if(failed || cancelled()) {
+        count_node(start, false);
+        return false;
+      }
       std::cout << "number of edges: "<<host.num_edges() << " (host) "<<guest.num_edges()<<" (guest)\n";
-      if(HG_label_match.size() <= 2) return true;
+      if(HG_label_match.size() <= 2) {
+        count_node(start, false);
+        return true;
+      }
       if(host.edgeless()){
+        count_node(start, false);
         if(guest.edgeless())
           return host.label(host.root()) == guest.label(guest.root());
         else
           return false;
       } else {
-        // We'll have to branch at this point. We would like to make visible as many leaf-components as possible on each branch.
-        // Branching will be done on invisible reticulations r above leaves s.t. r has few parents that see no component root and,
-        // among them, those that see few non-leaf-component roots.
+        // if we've already decided this sub-instance (reached via a different branching order), then just return the result
+        Fingerprint fp;
+        if(memo) {
+          fp = instance_fingerprint();
+          bool result;
+          if(memo->lookup(fp, result)) {
+            std::cout << "found sub-instance in the transposition table: "<<result<<"\n";
+            count_node(start, false);
+            return result;
+          }
+        }
 
-        // step 1: for each leaf z that does not see a non-leaf-component root, get the reticulation above z (if z does not have
-        // a reticulation parent, then cherry reduction must be applicable to it)
+        // We'll have to branch at this point.
         std::cout << "visibility: ";
         for(const auto& x: host.get_node_data()) std::cout << x <<"\n";
         std::cout << "label-matching: "<<HG_label_match<<"\n";
 
-        std::priority_queue<BranchInfo, std::vector<BranchInfo>, std::greater<BranchInfo>> branching_candidates;
-        for(const auto& HG_leaf_pair: seconds(HG_label_match)){
-          const Node u = HG_leaf_pair.first;
-          const Node rt_u = host[u].comp_root;
-          if(rt_u == NoNode) {
-            std::cout << u << " sees noone\n" << u <<"'s parents are "<<host.parents(u)<<"\n";
-            // if u does not see any component-root, then its parent is necessarily a reticulation (since cherry-reduction is applied continuously)
-            assert(host.in_degree(u) == 1);
-            const Node pu = host.parent(u);
-            assert(host.out_degree(pu) == 1);
-            assert(host.in_degree(pu) > 1);
-            // the parent reticulation cannot see a tree-component since u would see it too
-            assert(host[pu].comp_root == NoNode);
-            
-            BranchInfo pu_info(pu);
-            for(const Node x: host.parents(pu)) {
-              const Node rt_x = host[x].comp_root;
-              std::cout << "considering comp-root "<<rt_x <<" ("<<host[x]<<") of "<<pu<<"\n";
-              if(rt_x != NoNode){
-                if(comp_info.comp_DAG.is_leaf(rt_x))
-                  pu_info.parents_seeing_leaf_comp++;
-                else
-                  pu_info.parents_seeing_non_leaf_comp++;
-              } else pu_info.parents_seeing_noone++;
-            }
-            std::cout << "branch-info for "<<pu<<": "<<pu_info<<"\n";
-            branching_candidates.emplace(std::move(pu_info));
-          } else std::cout << rt_u << " is visible from "<<u<<" so one of the implied branches does not make progress. Ignoring "<<u<<"...\n";
+        const Node u = choose_branching();
+        if(u == NoNode) {
+          std::cout << "all branches fail in the lookahead\n";
+          count_node(start, false);
+          if(memo && !cancelled()) memo->insert(fp, false);
+          return false;
         }
-        std::cout << "found "<<branching_candidates.size() <<" branching opportunities\n";
-        assert(!branching_candidates.empty());
-        std::cout << "best branching: "<< branching_candidates.top() << "\n";
-
-        // for each parent u of the best-branching node v, make a copy of *this and make u the only parent of v, then run the machine again
-        const Node u = branching_candidates.top().node;
-        for(const Node v: host.parents(u)){
-          std::cout << "\n================ new branch: keep "<<v<<" --> "<<u<<" ====================\n\n";
+        if(budget && !budget->count_branch_node()) return false;
+        count_node(start, true);
+        if(!memo) return displayed_in_branches(u);
+        const bool result = displayed_in_branches(u);
+        // if we were cancelled, then our result is meaningless and we shouldn't remember it
+        if(!cancelled()) memo->insert(fp, result);
+        return result;
+      }
+    }
+
+  protected:
+
+    // for each parent v of the best-branching node u, make a copy of *this and make v the only parent of u, then run the machine again
+    bool displayed_in_branches(const Node u)
+    {
+      if(pool) return displayed_in_parallel_branches(u);
+      //NOTE: when branching in-place, the parents of u change during each branch, so we'll need a copy of them
+      const NodeVec u_parents(host.parents(u).begin(), host.parents(u).end());
+      for(const Node v: u_parents){
+        std::cout << "\n================ new branch: keep "<<v<<" --> "<<u<<" ====================\n\n";
+        if(cancelled()) return false;
+        if(budget) budget->count_branch(depth + 1);
+        if(trail) {
+          if(displayed_in_trailed_branch(u, v)) return true;
+        } else {
           TreeInNetContainment sub_checker(std::as_const(*this));
+          ++sub_checker.depth;
           sub_checker.force_parent(u, v);
           if(sub_checker.displayed()) return true;
-          std::cout << "unsuccessful branch :/\n";
         }
-        // if no branch returned true, then the tree is not displayed
-        return false;
+        std::cout << "unsuccessful branch :/\n";
+      }
+      // if no branch returned true, then the tree is not displayed
+      return false;
+    }
+
+    // explore the branch in which v is the only parent of u on *this and roll back all modifications afterwards
+    bool displayed_in_trailed_branch(const Node u, const Node v)
+    {
+      const bool was_failed = failed;
+      trail->checkpoint();
+      ++depth;
+      force_parent(u, v);
+      const bool result = displayed();
+      --depth;
+      trail->rollback();
+      failed = was_failed;
+      clear_reduction_queues();
+      return result;
+    }
+
+    // explore the branches for all parents of u as tasks of the thread pool; the first branch that finds an embedding cancels its siblings
+    //NOTE: the answer does not depend on which branch finishes first, since cancelled branches are only ever cancelled in favor of a "yes"
+    bool displayed_in_parallel_branches(const Node u)
+    {
+      const NodeVec u_parents(host.parents(u).begin(), host.parents(u).end());
+      BranchCancellation siblings(cancellation);
+      {
+        TaskGroup branches(*pool);
+        for(const Node v: u_parents)
+          branches.run([this, &siblings, u, v]{
+              if(siblings.cancelled()) return;
+              std::cout << "\n================ new parallel branch: keep "<<v<<" --> "<<u<<" ====================\n\n";
+              if(budget) budget->count_branch(depth + 1);
+              TreeInNetContainment sub_checker(std::as_const(*this));
+              sub_checker.cancellation = &siblings;
+              ++sub_checker.depth;
+              if(trail) sub_checker.use_undo_trail();
+              sub_checker.force_parent(u, v);
+              if(sub_checker.displayed()) siblings.raise();
+            });
+        branches.wait();
       }
+      return siblings.raised;
     }
 
+  public:
+
+    // explore branches using the given number of threads (1 = sequential exploration)
+    void set_num_threads(const size_t num_threads)
+    {
+      if(num_threads > 1)
+        pool = std::make_shared<WorkStealingPool>(num_threads - 1);
+      else pool.reset();
+    }
+
+    // remember the results of up to 'capacity' sub-instances, so they don't have to be solved again when reached via a different branching order
+    void use_transposition_table(const size_t capacity)
+    {
+      if(capacity > 0)
+        memo = std::make_shared<TranspositionTable<bool>>(capacity);
+      else memo.reset();
+    }
+    const std::shared_ptr<TranspositionTable<bool>>& get_transposition_table() const { return memo; }
+
+    // explore branches in-place, using an undo-trail to roll back failed branches (instead of copying *this for each branch)
+    void use_undo_trail(const bool enable = true)
+    {
+      if(enable && !trail) trail = std::make_unique<UndoTrail>();
+      UndoTrail* const new_trail = enable ? trail.get() : nullptr;
+      host.set_trail(new_trail);
+      guest.set_trail(new_trail);
+      comp_info.comp_DAG.set_trail(new_trail);
+      label_log.bind(*this, new_trail);
+      if(!enable) trail.reset();
+    }
+
+    // limit the resources of the search by the given budget (see search_budget.hpp), which may be shared with other threads (f.ex. to cancel the search)
+    //NOTE: the reductions that are applied when constructing the checker are not counted against the budget
+    void use_budget(std::shared_ptr<SearchBudget> _budget) { budget = std::move(_budget); }
+    const std::shared_ptr<SearchBudget>& get_budget() const { return budget; }
+
+    // choose the reticulations to branch on with the given strategy (see branching_strategy.hpp)
+    void use_branching_strategy(std::shared_ptr<const BranchingStrategy> _strategy) { strategy = std::move(_strategy); }
+    const std::shared_ptr<const BranchingStrategy>& get_branching_strategy() const { return strategy; }
+
+    // like displayed(), but if the budget ran out before the search was done, we don't know whether the guest is displayed
+    //NOTE: an embedding that has been found is never discarded, even if the budget ran out in the meantime
+    Verdict decide()
+    {
+      if(displayed()) return Verdict::displayed;
+      return (budget && budget->ran_out()) ? Verdict::unknown : Verdict::not_displayed;
+    }
+
+    // return whether a sibling of one of the branchings that led to us has already found an embedding or whether we ran out of budget
+    bool cancelled() const { return (cancellation && cancellation->cancelled()) || (budget && budget->exhausted()); }
+
   };
 
 
+
+  // a containment checker for many guest trees in the same host network: the host is preprocessed once (conversion to a mutable
+  // network, component infos with the component DAG, and the host-side of the label matching) and is then shared (read-only)
+  // by all queries, each of which only copies the preprocessed state it is going to modify
+  template<class Host, class Guest, bool leaf_labels_only = true>
+  class TreeInNetBatchContainment
+  {
+  public:
+    using Checker = TreeInNetContainment<Host, Guest, leaf_labels_only>;
+    using RWHost = typename Checker::RWHost;
+    using ComponentInfos = typename Checker::ComponentInfos;
+    using LabelMatching = typename Checker::LabelMatching;
+    // a function that can set up each checker before it starts its search (f.ex. calling use_undo_trail())
+    using Configurator = std::function<void(Checker&)>;
+    using Filter = ContainmentFilter<RWHost>;
+
+  protected:
+    RWHost host;
+    ComponentInfos comp_info;
+    LabelMatching host_labels;
+    std::unique_ptr<Filter> filter;
+    std::shared_ptr<ResultCache> cache;
+    Fingerprint host_fp;
+
+    template<class _Guest>
+    Verdict decide_uncached(_Guest&& guest, const Configurator& configure) const
+    {
+      if(filter && filter->rejects(guest)) return Verdict::not_displayed;
+      Checker checker(host, comp_info, host_labels, std::forward<_Guest>(guest));
+      if(configure) configure(checker);
+      return checker.decide();
+    }
+
+  public:
+
+    template<class _Host>
+    TreeInNetBatchContainment(_Host&& _host):
+      host(std::forward<_Host>(_host)),
+      comp_info(host),
+      host_labels(host.nodes_labeled(), std::vector<std::pair<Node, std::remove_cvref_t<typename RWHost::LabelType>>>())
+    {}
+
+    TreeInNetBatchContainment(const TreeInNetBatchContainment&) = delete;
+
+    const RWHost& get_host() const { return host; }
+    const Filter* get_filter() const { return filter.get(); }
+
+    // before setting up a checker for a guest, try to prove that the guest is not displayed, using the given budget (see containment_filter.hpp)
+    void use_filter(const size_t budget = config::filter_budget) { filter = std::make_unique<Filter>(host, budget); }
+
+    // look up each guest in the given result cache before setting up a checker for it, and store the results in the cache
+    //NOTE: the cache may be shared with other batches, and even other processes (see result_cache.hpp)
+    void use_result_cache(std::shared_ptr<ResultCache> _cache)
+    {
+      cache = std::move(_cache);
+      if(cache) host_fp = structural_fingerprint(host, leaf_labels_only);
+    }
+    const std::shared_ptr<ResultCache>& get_result_cache() const { return cache; }
+
+    // check whether the host displays the given guest tree
+    template<class _Guest>
+    bool displayed(_Guest&& guest, const Configurator& configure = {}) const
+    {
+      if(cache) return decide(std::forward<_Guest>(guest), configure) == Verdict::displayed;
+      if(filter && filter->rejects(guest)) return false;
+      Checker checker(host, comp_info, host_labels, std::forward<_Guest>(guest));
+      if(configure) configure(checker);
+      return checker.displayed();
+    }
+
+    // like displayed(), but return 'unknown' if the budget of the checker (set up by 'configure') ran out before it was done
+    template<class _Guest>
+    Verdict decide(_Guest&& guest, const Configurator& configure = {}) const
+    {
+      if(!cache) return decide_uncached(std::forward<_Guest>(guest), configure);
+      Fingerprint fp = host_fp;
+      fp += structural_fingerprint(guest, leaf_labels_only);
+      return cache->decide(fp, [&]{ return decide_uncached(std::forward<_Guest>(guest), configure); });
+    }
+
+  protected:
+    // run the query for each of the given guest trees (using the given number of threads) and store the results in the same order
+    template<class Result, class GuestContainer, class Query>
+    static void query_all(const GuestContainer& guests, const size_t num_threads, std::vector<Result>& results, const Query& query)
+    {
+      results.assign(guests.size(), Result());
+      if(num_threads > 1) {
+        WorkStealingPool pool(num_threads - 1);
+        TaskGroup queries(pool);
+        size_t i = 0;
+        for(const auto& guest: guests){
+          Result& result = results[i++];
+          queries.run([&result, &guest, &query]{ result = query(guest); });
+        }
+        queries.wait();
+      } else {
+        size_t i = 0;
+        for(const auto& guest: guests) results[i++] = query(guest);
+      }
+    }
+
+  public:
+    // check each of the given guest trees (using the given number of threads) and return the results in the same order
+    template<class GuestContainer>
+    std::vector<bool> displayed_all(const GuestContainer& guests, const size_t num_threads = 1, const Configurator& configure = {}) const
+    {
+      //NOTE: std::vector<bool> cannot be written concurrently, so we'll collect the results in a vector of chars first
+      std::vector<char> results;
+      query_all(guests, num_threads, results, [this, &configure](const auto& guest) -> char { return displayed(guest, configure); });
+      return {results.begin(), results.end()};
+    }
+
+    // decide each of the given guest trees (using the given number of threads) and return the results in the same order
+    template<class GuestContainer>
+    std::vector<Verdict> decide_all(const GuestContainer& guests, const size_t num_threads = 1, const Configurator& configure = {}) const
+    {
+      std::vector<Verdict> results;
+      query_all(guests, num_threads, results, [this, &configure](const auto& guest) { return decide(guest, configure); });
+      return results;
+    }
+  };
+
 }
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include "utils.hpp"
+#include "config.hpp"
+#include "iter_bitset.hpp"
+
+/*
+ * a cheap filter that proves that a host network does not display a guest tree for many obviously incompatible pairs,
+ * so that the containment engine does not have to be set up for them
+ * the filter checks necessary conditions only, so if it does not reject a pair, the pair may or may not be displayed:
+ * 1. each leaf label of the guest must be the label of a leaf of the host
+ * 2. if uv is a bridge of the host, then all paths from the root to the leaves below v pass through v, so the leaves below v
+ *    form a cluster of each tree displayed by the host; thus, those of them that occur in the guest must form a cluster of the guest
+ * for 2., we compute the clusters of the host as bitsets over the leaves of the guest, numbered such that each cluster of the guest
+ * is an interval; the cost of this is about (number of host edges) * (number of guest leaves) / 64, and we skip 2. if this exceeds the budget
+ */
+
+namespace PT{
+
+  template<class Host>
+  class ContainmentFilter
+  {
+  public:
+    using LabelType = std::remove_cvref_t<typename Host::LabelType>;
+
+  protected:
+    const Host& host;
+    const size_t budget;
+
+    HashMap<LabelType, Node> leaf_of_label; // map each label to the host leaf with this label
+    HashSet<Node> bridge_heads;
+    NodeVec host_postorder;
+    bool multi_labeled = false;
+
+    mutable std::atomic<size_t> checked = 0;
+    mutable std::atomic<size_t> rejected = 0;
+    mutable std::atomic<size_t> over_budget = 0;
+
+  public:
+
+    ContainmentFilter(const Host& _host, const size_t _budget = config::filter_budget):
+      host(_host), budget(_budget)
+    {
+      for(const Node x: host.leaves()) {
+        const auto& x_label = host.label(x);
+        if(!x_label.empty() && !leaf_of_label.try_emplace(x_label, x).second) multi_labeled = true;
+      }
+      for(const auto& uv: host.get_bridges()) bridge_heads.insert(uv.head());
+      host_postorder.reserve(host.num_nodes());
+      for(const Node x: host.dfs().postorder()) host_postorder.push_back(x);
+    }
+
+    ContainmentFilter(const ContainmentFilter&) = delete;
+
+    // return true if we can prove that the host does not display the guest
+    //NOTE: this is thread-safe, so guests can be checked in parallel
+    template<class Guest>
+    bool rejects(const Guest& guest) const
+    {
+      ++checked;
+      if(_rejects(guest)) {
+        ++rejected;
+        return true;
+      } else return false;
+    }
+
+    size_t num_checked() const { return checked; }
+    size_t num_rejected() const { return rejected; }
+    size_t num_over_budget() const { return over_budget; }
+
+    friend std::ostream& operator<<(std::ostream& os, const ContainmentFilter& f)
+    {
+      return os << "rejected " << f.rejected << " of " << f.checked << " pairs (cluster test skipped for "
+                << f.over_budget << " pairs exceeding the budget of " << f.budget << ")";
+    }
+
+  protected:
+
+    template<class Guest>
+    bool _rejects(const Guest& guest) const
+    {
+      // we cannot tell which host leaf a label refers to if the host is multi-labeled
+      if(multi_labeled || guest.empty()) return false;
+
+      // step 1: number the leaves of the guest in preorder, so that each cluster is an interval, and check that each label appears in the host
+      HashMap<LabelType, size_t> rank_of_label;
+      for(const Node x: guest.dfs().preorder()) {
+        if(guest.is_leaf(x)) {
+          const auto& x_label = guest.label(x);
+          if(x_label.empty() || !rank_of_label.try_emplace(x_label, rank_of_label.size()).second) return false;
+          if(!test(leaf_of_label, x_label)) {
+            std::cout << "filter: guest label "<< x_label << " does not appear in the host\n";
+            return true;
+          }
+        }
+      }
+      const size_t num_leaves = rank_of_label.size();
+      if(num_leaves < 3) return false;
+
+      // step 2: check the budget
+      const size_t cost = host.num_edges() * ((num_leaves + 63) / 64);
+      if(cost > budget) {
+        ++over_budget;
+        return false;
+      }
+
+      // step 3: compute the clusters of the guest as intervals of leaf-ranks
+      typename Guest::template NodeMap<std::pair<size_t, size_t>> interval;
+      std::vector<std::pair<size_t, size_t>> guest_clusters;
+      guest_clusters.reserve(guest.num_nodes());
+      for(const Node x: guest.dfs().postorder()) {
+        std::pair<size_t, size_t> x_interval;
+        if(guest.is_leaf(x)) {
+          const size_t x_rank = rank_of_label.at(guest.label(x));
+          x_interval = {x_rank, x_rank};
+        } else {
+          x_interval = {num_leaves, 0};
+          for(const Node y: guest.children(x)) {
+            const auto& y_interval = interval.at(y);
+            x_interval.first = std::min(x_interval.first, y_interval.first);
+            x_interval.second = std::max(x_interval.second, y_interval.second);
+          }
+        }
+        interval.try_emplace(x, x_interval);
+        guest_clusters.push_back(x_interval);
+      }
+      std::sort(guest_clusters.begin(), guest_clusters.end());
+
+      // step 4: compute the clusters of the host (restricted to the guest's leaves) bottom-up and check those below bridges
+      //NOTE: to save memory, we forget the cluster of a node once all its parents have seen it
+      HashMap<Node, std::ordered_bitset> cluster;
+      HashMap<Node, size_t> unseen_parents;
+      for(const Node x: host_postorder) {
+        std::ordered_bitset& x_cluster = cluster.try_emplace(x, num_leaves).first->second;
+        if(host.is_leaf(x)) {
+          const auto rank_iter = rank_of_label.find(host.label(x));
+          if(rank_iter != rank_of_label.end()) x_cluster.set(rank_iter->second);
+        } else {
+          for(const Node y: host.children(x)) {
+            const auto y_iter = cluster.find(y);
+            x_cluster |= y_iter->second;
+            if(--unseen_parents.at(y) == 0) cluster.erase(y_iter);
+          }
+        }
+        if(test(bridge_heads, x)) {
+          const size_t k = x_cluster.count();
+          if((k > 1) && (k < num_leaves)) {
+            const std::pair<size_t, size_t> x_interval = {x_cluster.min(), x_cluster.max()};
+            if((x_interval.second - x_interval.first + 1 != k) || !std::binary_search(guest_clusters.begin(), guest_clusters.end(), x_interval)) {
+              std::cout << "filter: the host's cluster below the bridge-head "<< x <<" is not a cluster of the guest\n";
+              return true;
+            }
+          }
+        }
+        unseen_parents.try_emplace(x, host.in_degree(x));
+      }
+      return false;
+    }
+  };
+
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <optional>
+#include <atomic>
+#include "utils.hpp"
+#include "config.hpp"
+#include "network.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+/*
+ * enumerate the trees displayed by a network lazily: a "switching" of the network keeps one parent for each reticulation and each
+ * switching gives a displayed tree by removing unlabeled leaves and suppressing nodes with in- and out-degree 1
+ * we go through the switchings in (reflected, mixed-radix) Gray-code order, so consecutive switchings differ only in the parent of a
+ * single reticulation; we never copy the network, instead, we keep, for each node, the node representing it in the displayed tree
+ * and the fingerprint of its subtree; when a reticulation switches from one parent to another, only the nodes on the paths from
+ * these parents to the root (in the switching) have to be updated (the switching is a spanning tree of the network, so the subtrees
+ * of all other nodes stay the same); thus, a step costs amortized O(1) for finding the reticulation to switch plus O(length of
+ * the root-paths of its old and new parent) for the update; only trees whose fingerprint has not been seen are built (in O(n))
+ * different switchings often give the same tree, so we skip trees whose fingerprint (which does not depend on node indices or the
+ * order of children) has been seen recently; to keep the memory bounded, we remember only a bounded number of fingerprints
+ * (config::displayed_trees_dedup_capacity), so once more trees than that have been reported, a tree may be reported more than once
+ * for parallel enumeration, the switchings are partitioned by the parents of the last few reticulations and the parts are enumerated
+ * by independent enumerators sharing the table of seen fingerprints (see for_each_displayed_tree())
+ */
+
+namespace PT{
+
+  struct DisplayedTreesStats
+  {
+    size_t switchings = 0;  // number of switchings we looked at
+    size_t trees = 0;       // number of trees we reported
+    size_t duplicates = 0;  // number of trees we skipped because they were reported before
+
+    DisplayedTreesStats& operator+=(const DisplayedTreesStats& other)
+    {
+      switchings += other.switchings;
+      trees += other.trees;
+      duplicates += other.duplicates;
+      return *this;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const DisplayedTreesStats& s)
+    {
+      return os << s.switchings << " switchings, " << s.trees << " distinct trees, " << s.duplicates << " duplicates";
+    }
+  };
+
+  using SeenTrees = TranspositionTable<bool>;
+
+  template<class Network, class Tree = CompatibleRWTree<Network>, bool leaf_labels_only = true>
+  class DisplayedTreeEnumerator
+  {
+  public:
+    using LabelMap = typename Tree::LabelMap;
+
+  protected:
+    const Network& N;
+    // the reticulations and their parents; the i'th reticulation keeps its choice[i]'th parent in the current switching
+    NodeVec retis;
+    std::vector<NodeVec> reti_parents;
+    std::vector<size_t> choice;
+    // the direction in which each choice moves next in the Gray code
+    std::vector<bool> ascending;
+    // we vary only the choices for the first num_free reticulations, the others are fixed
+    size_t num_free;
+    // for each reticulation, its parent in the current switching
+    typename Network::template NodeMap<Node> kept_parent;
+    bool done = false;
+
+    std::shared_ptr<SeenTrees> seen;
+    DisplayedTreesStats stats;
+
+    // for each node, the node representing it in the displayed tree (NoNode if its subtree contains no labeled leaf)
+    typename Network::template NodeMap<Node> rep;
+    // for each node representing itself, the fingerprint of the subtree below it in the displayed tree
+    typename Network::template NodeMap<Fingerprint> sig;
+    // all nodes in preorder of the first switching
+    NodeVec order;
+    NodeVec labeled;
+    // the nodes on the root-path of the new parent of the last reticulation that switched are marked with the current stamp
+    typename Network::template NodeMap<size_t> path_stamp;
+    size_t stamp = 0;
+
+    void set_choice(const size_t i, const size_t c)
+    {
+      choice[i] = c;
+      kept_parent[retis[i]] = reti_parents[i][c];
+    }
+
+    // let the i'th reticulation keep its c'th parent and update the nodes on the root-paths of its old and new parent
+    // (in time linear in the length of these paths)
+    void switch_choice(const size_t i, const size_t c)
+    {
+      const Node old_parent = kept_parent[retis[i]];
+      set_choice(i, c);
+      const Node new_parent = kept_parent[retis[i]];
+      // the paths meet at some node (the root at the latest), from which on we only have to update them once
+      ++stamp;
+      for(Node x = new_parent; x != NoNode; x = switching_parent(x)) path_stamp[x] = stamp;
+      for(Node x = old_parent; path_stamp[x] != stamp; x = switching_parent(x)) update_node(x);
+      for(Node x = new_parent; x != NoNode; x = switching_parent(x)) update_node(x);
+    }
+
+    // go to the next switching in Gray-code order: move the first choice that can move in its direction and turn around all choices
+    // before it (which are at the end of their range); each choice turns around only once every 2 moves, so finding the choice to
+    // move is amortized O(1) (the update of the switching in switch_choice() is not)
+    void advance()
+    {
+      for(size_t i = 0; i < num_free; ++i) {
+        if(ascending[i]) {
+          if(choice[i] + 1 < reti_parents[i].size()) return switch_choice(i, choice[i] + 1);
+        } else if(choice[i] > 0) return switch_choice(i, choice[i] - 1);
+        ascending[i] = !ascending[i];
+      }
+      done = true;
+    }
+
+    bool in_switching(const Node x, const Node y) const { return (N.in_degree(y) <= 1) || (kept_parent.at(y) == x); }
+
+    // the parent of x in the current switching (NoNode for the root)
+    Node switching_parent(const Node x) const
+    {
+      switch(N.in_degree(x)) {
+        case 0: return NoNode;
+        case 1: return N.parent(x);
+        default: return kept_parent.at(x);
+      }
+    }
+
+    // find the node representing x in the displayed tree (and the fingerprint of its subtree) from those of its children
+    //NOTE: like structural_fingerprint(), the fingerprint does not depend on node indices or the order of children, but we compute
+    //      it from the switching, so we don't have to construct trees that turn out to be duplicates
+    void update_node(const Node x)
+    {
+      const std::hash<std::remove_cvref_t<typename Network::LabelType>> label_hash;
+      Node& x_rep = rep[x];
+      size_t num_reps = 0;
+      Fingerprint children_sig = {0, 0};
+      for(const Node y: N.children(x)) {
+        if(in_switching(x, y) && (rep[y] != NoNode)) {
+          x_rep = (num_reps++ == 0) ? rep[y] : x;
+          const Fingerprint& y_sig = sig[rep[y]];
+          children_sig.first += uint64_hash(y_sig.first);
+          children_sig.second += uint64_hash(y_sig.second ^ 0x5bd1e995);
+        }
+      }
+      if(num_reps == 0) x_rep = (N.is_leaf(x) && N.has_label(x)) ? x : NoNode;
+      if(x_rep == x) {
+        Fingerprint& x_sig = sig[x];
+        x_sig = {num_reps + 1, num_reps + 2};
+        if((!leaf_labels_only || (num_reps == 0)) && N.has_label(x)) {
+          const size_t lh = label_hash(N.label(x));
+          x_sig.first ^= uint64_hash(lh);
+          x_sig.second ^= uint64_hash(lh + 1);
+        }
+        x_sig += children_sig;
+      }
+    }
+
+    // go through the first switching bottom-up and update all nodes
+    //NOTE: each node has a parent in each switching (unless it is the root), so each switching contains all nodes
+    void read_switching()
+    {
+      NodeVec todo = {N.root()};
+      while(!todo.empty()) {
+        const Node x = value_pop_back(todo);
+        order.push_back(x);
+        for(const Node y: N.children(x))
+          if(in_switching(x, y)) todo.push_back(y);
+      }
+      // the switching is a tree, so going through its preorder backwards treats all children of a node before the node
+      for(auto x_iter = order.rbegin(); x_iter != order.rend(); ++x_iter) update_node(*x_iter);
+    }
+
+    // the fingerprint of the displayed tree of the current switching
+    Fingerprint current_fingerprint() const
+    {
+      if(N.empty()) return {0, 0};
+      const Node root_rep = rep.at(N.root());
+      return (root_rep != NoNode) ? sig.at(root_rep) : Fingerprint{0, 0};
+    }
+
+    // construct the displayed tree of the current switching
+    void current_tree(EdgeVec& edges, LabelMap& labels)
+    {
+      labeled.clear();
+      for(const Node x: order)
+        if(rep[x] == x) {
+          if(N.has_label(x)) labeled.push_back(x);
+          for(const Node y: N.children(x))
+            if(in_switching(x, y) && (rep[y] != NoNode)) edges.emplace_back(x, rep[y]);
+        }
+      //NOTE: some label maps (raw_vector_map) need their keys to be inserted in increasing order
+      std::sort(labeled.begin(), labeled.end());
+      for(const Node x: labeled) labels.try_emplace(x, N.label(x));
+    }
+
+  public:
+
+    // enumerate the trees displayed by _N; if fixed_choices is given, then enumerate only the switchings in which the last
+    // fixed_choices.size() reticulations keep the parents given by fixed_choices (as indices into their parents() containers)
+    //NOTE: enumerators working on disjoint parts of the switchings can share their table of seen fingerprints
+    DisplayedTreeEnumerator(const Network& _N,
+                            std::shared_ptr<SeenTrees> _seen = std::make_shared<SeenTrees>(config::displayed_trees_dedup_capacity),
+                            const std::vector<size_t>& fixed_choices = {}):
+      N(_N), seen(std::move(_seen))
+    {
+      for(const Node z: N.nodes()) {
+        rep.try_emplace(z, NoNode);
+        sig.try_emplace(z);
+        path_stamp.try_emplace(z, 0);
+        if(N.in_degree(z) > 1) {
+          retis.push_back(z);
+          reti_parents.emplace_back(N.parents(z).begin(), N.parents(z).end());
+          kept_parent.try_emplace(z, NoNode);
+        }
+      }
+      assert(fixed_choices.size() <= retis.size());
+      num_free = retis.size() - fixed_choices.size();
+      choice.assign(retis.size(), 0);
+      ascending.assign(retis.size(), true);
+      for(size_t i = 0; i < retis.size(); ++i)
+        set_choice(i, (i < num_free) ? 0 : fixed_choices[i - num_free]);
+      if(!N.empty()) read_switching();
+    }
+
+    DisplayedTreeEnumerator(const DisplayedTreeEnumerator&) = delete;
+
+    const DisplayedTreesStats& get_stats() const { return stats; }
+    size_t num_reticulations() const { return retis.size(); }
+    // the number of parents of the i'th reticulation (the last reticulations are the ones fixed by the constructor)
+    size_t num_choices(const size_t i) const { return reti_parents[i].size(); }
+
+    // construct the next displayed tree that has not been seen before in 'tree' and return true, or return false if there is none
+    bool next(std::optional<Tree>& tree)
+    {
+      while(!done) {
+        ++stats.switchings;
+        const Fingerprint fp = current_fingerprint();
+        if(seen->insert_new(fp, true)) {
+          EdgeVec edges;
+          LabelMap labels;
+          current_tree(edges, labels);
+          advance();
+          tree.reset();
+          tree.emplace(std::move(edges), std::move(labels));
+          ++stats.trees;
+          return true;
+        } else ++stats.duplicates;
+        advance();
+      }
+      tree.reset();
+      return false;
+    }
+
+    // range-for support: for(const auto& T: DisplayedTreeEnumerator<Network>(N)) ...
+    class iterator
+    {
+      DisplayedTreeEnumerator* source;
+      std::optional<Tree> current;
+    public:
+      iterator(DisplayedTreeEnumerator* _source = nullptr): source(_source) { if(source) ++(*this); }
+      const Tree& operator*() const { return *current; }
+      const Tree* operator->() const { return &(*current); }
+      iterator& operator++() { if(!source->next(current)) source = nullptr; return *this; }
+      bool operator==(const iterator& other) const { return source == other.source; }
+      bool operator!=(const iterator& other) const { return source != other.source; }
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+  };
+
+
+  // call f on each distinct tree displayed by N using the given number of threads and return the statistics of the enumeration;
+  // f returns whether to go on, so the enumeration stops (soon) after f returned false for the first time
+  //NOTE: with more than 1 thread, f is called concurrently, so it has to be thread-safe
+  template<class Network, class Tree = CompatibleRWTree<Network>, bool leaf_labels_only = true, class Callback>
+  DisplayedTreesStats for_each_displayed_tree(const Network& N,
+                                              Callback&& f,
+                                              const size_t num_threads = 1,
+                                              std::shared_ptr<SeenTrees> seen = std::make_shared<SeenTrees>(config::displayed_trees_dedup_capacity))
+  {
+    using Enumerator = DisplayedTreeEnumerator<Network, Tree, leaf_labels_only>;
+    if(num_threads <= 1) {
+      Enumerator all_trees(N, std::move(seen));
+      for(const Tree& T: all_trees)
+        if(!f(T)) break;
+      return all_trees.get_stats();
+    }
+
+    // fix the last few reticulations such that there are some parts per thread (so the pool can balance the load)
+    std::vector<size_t> radix;
+    {
+      const Enumerator all_trees(N, seen);
+      size_t num_parts = 1;
+      for(size_t i = all_trees.num_reticulations(); (i > 0) && (num_parts < 8 * num_threads); num_parts *= radix.back())
+        radix.push_back(all_trees.num_choices(--i));
+    }
+    // the last reticulation is at the front of radix, so reverse it to match the fixed choices
+    std::reverse(radix.begin(), radix.end());
+
+    DisplayedTreesStats stats;
+    std::mutex stats_lock;
+    std::atomic<bool> stopped = false;
+    WorkStealingPool pool(num_threads - 1);
+    TaskGroup parts(pool);
+    std::vector<size_t> fixed(radix.size(), 0);
+    while(1) {
+      parts.run([&, fixed]{
+          if(stopped) return;
+          Enumerator part_trees(N, seen, fixed);
+          for(const Tree& T: part_trees)
+            if(stopped || !f(T)) { stopped = true; break; }
+          const std::lock_guard<std::mutex> guard(stats_lock);
+          stats += part_trees.get_stats();
+        });
+      // count through all choices of the fixed reticulations like an odometer
+      size_t i = 0;
+      while((i < fixed.size()) && (++fixed[i] == radix[i])) fixed[i++] = 0;
+      if(i == fixed.size()) break;
+    }
+    parts.wait();
+    return stats;
+  }
+
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <optional>
+#include "utils.hpp"
+#include "worklist.hpp"
+#include "containment.hpp"
+
+/*
+ * incremental tree containment: a host network is edited again and again (f.ex. by a network-search heuristic) and, after each edit,
+ * we want to know which of a fixed set of guest trees it still displays
+ * instead of preprocessing the host and checking all trees from scratch after each edit, we keep the preprocessed host and the
+ * verdicts of the last check, and we listen to the modifications of the host to find the part of it that the edits affected:
+ * (1) the tree-component infos are recomputed only for the tree components around the modified nodes (and the reticulation chains
+ *     below them), unless these components make up more than a given fraction of the host, in which case we recompute them for the
+ *     whole host
+ * (2) verdicts are kept if the edit cannot have changed them: adding an arc between two existing inner nodes keeps all displayed trees
+ *     displayed, removing an arc into a reticulation keeps all non-displayed trees non-displayed, and subdividing an arc does not change
+ *     the displayed trees at all; after any other edit (see modify()), all trees are checked again
+ */
+
+namespace PT{
+
+  struct IncrementalStats
+  {
+    size_t edits = 0;
+    size_t trees_checked = 0;   // number of times the tree-containment engine was run
+    size_t trees_kept = 0;      // number of times the verdict of a tree was kept after an edit
+    size_t local_updates = 0;   // number of times the component infos were recomputed only around the edits
+    size_t full_updates = 0;    // number of times the component infos were recomputed for the whole host
+
+    friend std::ostream& operator<<(std::ostream& os, const IncrementalStats& s)
+    {
+      return os << s.edits << " edits, " << s.trees_checked << " trees checked, " << s.trees_kept << " verdicts kept, "
+                << s.local_updates << " local and " << s.full_updates << " full component updates";
+    }
+  };
+
+  template<class Host, class Guest, bool leaf_labels_only = true>
+  class IncrementalContainment
+  {
+  public:
+    using Checker = TreeInNetContainment<Host, Guest, leaf_labels_only>;
+    using RWHost = typename Checker::RWHost;
+    using ComponentInfos = typename Checker::ComponentInfos;
+    using LabelMatching = typename Checker::LabelMatching;
+    using Configurator = std::function<void(Checker&)>;
+
+  protected:
+    struct ModifiedNodes: public ModificationListener
+    {
+      NodeWorklist nodes;
+      void modifying(const Node x) override { nodes.push(x); }
+    };
+
+    RWHost host;
+    std::vector<Guest> guests;
+    std::vector<Verdict> verdicts;
+    std::optional<ComponentInfos> comp_info;
+    std::optional<LabelMatching> host_labels;
+    // the components seen by the reticulation parents of each non-trivial component root (its parents in the component DAG)
+    HashMap<Node, NodeVec> comp_above;
+    ModifiedNodes modified;
+
+    // which verdicts may have changed since the last check
+    bool displayed_may_change = true;
+    bool not_displayed_may_change = true;
+    // if the tree components around the modified nodes contain more than this fraction of the nodes of the host, recompute everything
+    double max_update_fraction;
+    IncrementalStats stats;
+
+    void recompute_labels()
+    {
+      host_labels.emplace(host.nodes_labeled(), std::vector<std::pair<Node, std::remove_cvref_t<typename RWHost::LabelType>>>());
+    }
+
+    void recompute_components()
+    {
+      ++stats.full_updates;
+      for(const Node x: host.nodes()) host[x].clear();
+      comp_info.reset();
+      comp_info.emplace(host);
+      comp_above.clear();
+      const auto& cDAG = comp_info->comp_DAG;
+      for(const Node u: cDAG.nodes())
+        if(cDAG.in_degree(u) > 0) comp_above.try_emplace(u, cDAG.parents(u).begin(), cDAG.parents(u).end());
+    }
+
+    // return the root of the tree component containing the tree node x (or NoNode if x is a reticulation or not connected to the root)
+    Node component_root_above(Node x) const
+    {
+      if(host.in_degree(x) > 1) return NoNode;
+      while(host.in_degree(x) == 1) {
+        const Node px = host.parent(x);
+        if(host.is_reti(px)) break;
+        x = px;
+      }
+      return ((host.in_degree(x) == 1) || (x == host.root())) ? x : NoNode;
+    }
+
+    // recompute the component infos for all components around the modified nodes, that is, the components containing them, their
+    // parents and children, and the components that they were in before the modification
+    void update_components()
+    {
+      if(modified.nodes.empty()) return;
+      NodeVec roots;
+      const auto add_root_above = [&](const Node y) {
+        const Node rt = component_root_above(y);
+        if(rt != NoNode) roots.push_back(rt);
+      };
+      while(!modified.nodes.empty()) {
+        const Node x = modified.nodes.pop();
+        if(!host.has_node(x)) {
+          comp_above.erase(x);
+          continue;
+        }
+        add_root_above(x);
+        for(const Node y: host.parents(x)) add_root_above(y);
+        for(const Node y: host.children(x)) add_root_above(y);
+        const Node old_root = host[x].comp_root;
+        if((old_root != NoNode) && host.has_node(old_root)) add_root_above(old_root);
+      }
+      const size_t max_nodes = max_update_fraction * host.num_nodes();
+      if(comp_info && comp_info->update_components(roots, comp_above, max_nodes))
+        ++stats.local_updates;
+      else recompute_components();
+    }
+
+    bool needs_check(const Verdict v) const
+    {
+      switch(v){
+        case Verdict::displayed: return displayed_may_change;
+        case Verdict::not_displayed: return not_displayed_may_change;
+        default: return displayed_may_change || not_displayed_may_change;
+      }
+    }
+
+    // remove the node x if it is an unlabeled leaf (and continue with its parents) or suppress it if it has in- and out-degree 1
+    //NOTE: none of this changes the displayed trees
+    void clean_up(const Node x)
+    {
+      if(!host.has_node(x)) return;
+      switch(host.out_degree(x)){
+        case 0:
+          if((x != host.root()) && (!host.has_label(x) || host.label(x).empty())) {
+            const NodeVec x_parents(host.parents(x).begin(), host.parents(x).end());
+            host.remove_node(x);
+            for(const Node y: x_parents) clean_up(y);
+          }
+          break;
+        case 1:
+          if(host.in_degree(x) <= 1) host.contract_downwards(x, host.any_child(x));
+          break;
+        default: break;
+      }
+    }
+
+    // the edits without counting them
+    Node subdivide_arc(const Node u, const Node v)
+    {
+      const Node w = host.subdivide(u, v);
+      host[w].clear();
+      return w;
+    }
+
+    bool add_arc(const Node u, const Node v)
+    {
+      if(host.is_leaf(u) || (host.in_degree(v) == 0)) displayed_may_change = true;
+      not_displayed_may_change = true;
+      return host.add_edge(u, v);
+    }
+
+  public:
+
+    template<class _Host, class GuestContainer>
+    IncrementalContainment(_Host&& _host, const GuestContainer& _guests, const double _max_update_fraction = config::incremental_update_fraction):
+      host(std::forward<_Host>(_host)),
+      guests(_guests.begin(), _guests.end()),
+      verdicts(guests.size(), Verdict::unknown),
+      max_update_fraction(_max_update_fraction)
+    {
+      recompute_labels();
+      recompute_components();
+      host.set_listener(&modified);
+    }
+
+    IncrementalContainment(const IncrementalContainment&) = delete;
+
+    const RWHost& get_host() const { return host; }
+    const std::vector<Guest>& get_guests() const { return guests; }
+    const IncrementalStats& get_stats() const { return stats; }
+    const ComponentInfos& get_component_infos() { update_components(); return *comp_info; }
+
+    // ************* edits *************
+    // subdivide the arc uv with a new node and return it; the displayed trees stay the same
+    Node subdivide(const Node u, const Node v)
+    {
+      ++stats.edits;
+      return subdivide_arc(u, v);
+    }
+
+    // add the arc uv; if u is not a leaf and v is not the root, then all displayed trees stay displayed
+    //NOTE: the caller has to make sure that this does not create a cycle
+    bool add_edge(const Node u, const Node v)
+    {
+      ++stats.edits;
+      return add_arc(u, v);
+    }
+
+    // subdivide the arcs ab and cd with new nodes u and v and add the arc uv (counted as a single edit); return uv
+    // all displayed trees stay displayed
+    //NOTE: the caller has to make sure that this does not create a cycle (that is, there is no path from d to a)
+    std::pair<Node, Node> connect_arcs(const Node a, const Node b, const Node c, const Node d)
+    {
+      ++stats.edits;
+      const Node u = subdivide_arc(a, b);
+      const Node v = subdivide_arc(c, d);
+      add_arc(u, v);
+      return {u, v};
+    }
+
+    // remove the arc uv and clean up u and v (removing unlabeled leaves and suppressing nodes with in- and out-degree 1);
+    // if v is a reticulation, then all trees that are not displayed stay not displayed
+    bool remove_edge(const Node u, const Node v)
+    {
+      ++stats.edits;
+      if(!host.is_reti(v)) not_displayed_may_change = true;
+      displayed_may_change = true;
+      if(!host.remove_edge(u, v)) return false;
+      clean_up(u);
+      clean_up(v);
+      return true;
+    }
+
+    // apply any other edit f to the host (for example, f may be [](auto& N){ N.contract_upwards(..); }); afterwards, all trees
+    // will be checked again
+    template<class Function>
+    void modify(Function&& f)
+    {
+      ++stats.edits;
+      displayed_may_change = not_displayed_may_change = true;
+      f(host);
+      recompute_labels();
+    }
+
+    // ************* queries *************
+    // check each of the guest trees whose verdict may have changed since the last time and return the verdicts of all guests
+    const std::vector<Verdict>& decide_all(const Configurator& configure = {})
+    {
+      update_components();
+      for(size_t i = 0; i < guests.size(); ++i) {
+        if(needs_check(verdicts[i])) {
+          Checker checker(host, *comp_info, *host_labels, guests[i]);
+          if(configure) configure(checker);
+          verdicts[i] = checker.decide();
+          ++stats.trees_checked;
+        } else ++stats.trees_kept;
+      }
+      displayed_may_change = not_displayed_may_change = false;
+      return verdicts;
+    }
+
+    // return whether the host displays all guest trees
+    bool all_displayed(const Configurator& configure = {})
+    {
+      for(const Verdict v: decide_all(configure))
+        if(v != Verdict::displayed) return false;
+      return true;
+    }
+  };
+
+}
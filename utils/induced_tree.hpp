@@ -117,6 +117,21 @@ namespace PT{
 
   protected:
     inline void append_unless_equal(EdgeVec& ev, const Node u, const Node v) { if(u != v) append(ev, u, v); }
+
+    // since we know the distances to the root, we can find the LCA of x and y by walking up in lockstep from the same depth
+    //NOTE: this takes O(dist(x,y)) time and, as opposed to the supertree's LCA, it does not allocate a bitset of seen nodes
+    Node LCA(Node x, Node y) const
+    {
+      size_t x_depth = node_infos->at(x).dist_to_root;
+      size_t y_depth = node_infos->at(y).dist_to_root;
+      for(; x_depth > y_depth; --x_depth) x = supertree.parent(x);
+      for(; y_depth > x_depth; --y_depth) y = supertree.parent(y);
+      while(x != y) {
+        x = supertree.parent(x);
+        y = supertree.parent(y);
+      }
+      return x;
+    }
     // choose the right parent between a choice of two indices in inner_nodes (which may be -1)
     ssize_t choose_parent(const ssize_t u_idx, const ssize_t v_idx) const
     {
@@ -131,7 +146,7 @@ namespace PT{
       for(auto iter = leaves_sorted->begin(); iter != leaves_sorted->end();){
         const Node u = *iter;
         if(++iter == leaves_sorted->end()) break;
-        const Node l = supertree.LCA(u, *iter);
+        const Node l = LCA(u, *iter);
         std::cout << "adding LCA("<<u<<", "<<*iter<<") = "<<l<<" as inner node with dist "<<node_infos->at(l).dist_to_root<<"\n";
         append(inner_nodes, l, node_infos->at(l).dist_to_root);
       }
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include "utils.hpp"
+#include "config.hpp"
+
+/*
+ * merge k sorted runs into one sorted sequence, comparing the items by a key that is computed once per item
+ * depending on the fan-in k and the total number n of items, we choose one of 3 strategies:
+ * (1) k <= config::vector_queue_merge_threshold (only when merging into a container): append the runs one by one and merge each
+ *     into the result (O(nk) comparisons, but very little overhead)
+ * (2) n <= config::kway_merge_sort_threshold: collect all (key, item) pairs and sort them
+ * (3) otherwise: a loser tree (tournament tree) over the keys of the heads of the runs, which needs log(k) comparisons of keys per
+ *     item (and no comparator calls at all), as opposed to the ~2log(k) comparator calls of a binary heap
+ * the merge is stable: items with equal keys are output in the order of their runs (and in the order within their run)
+ * a merger keeps its buffers between merges, so it should be reused (f.ex. as part of a workspace) to avoid allocations
+ */
+
+namespace PT{
+
+  template<class Iter, class Key = size_t>
+  class KWayMerge
+  {
+    using Item = std::remove_cvref_t<decltype(*std::declval<Iter>())>;
+
+    struct Run
+    {
+      Iter current;
+      Iter end;
+    };
+    std::vector<Run> runs;
+    size_t total_size = 0;
+
+    // for each run, the key of its current head
+    std::vector<Key> head_keys;
+    // tree[0] is the index of the winning run and tree[1..k-1] are the indices of the losers of the inner nodes of the tournament
+    //NOTE: the index k stands for a virtual run that beats every other run (used to initialize the tree)
+    std::vector<size_t> tree;
+    // buffers for the sort strategy: the keys with the positions of their items and the items with the indices of their runs
+    std::vector<std::pair<Key, size_t>> keyed;
+    std::vector<std::pair<Item, size_t>> items;
+
+    // return whether run i beats run j (exhausted runs lose against everyone, ties are broken by the run index)
+    bool beats(const size_t i, const size_t j) const
+    {
+      const size_t k = runs.size();
+      if(i == k) return true;
+      if(j == k) return false;
+      const bool i_done = (runs[i].current == runs[i].end);
+      const bool j_done = (runs[j].current == runs[j].end);
+      if(i_done || j_done) return j_done && !i_done;
+      if(head_keys[i] != head_keys[j]) return head_keys[i] < head_keys[j];
+      return i < j;
+    }
+
+    // replay the matches on the path from the leaf of run i to the root of the tournament
+    void replay(const size_t i)
+    {
+      size_t winner = i;
+      for(size_t t = (i + runs.size()) / 2; t > 0; t /= 2)
+        if(beats(tree[t], winner)) std::swap(tree[t], winner);
+      tree[0] = winner;
+    }
+
+    template<class KeyOf, class Emit>
+    void merge_by_tournament(KeyOf&& key_of, Emit&& emit)
+    {
+      const size_t k = runs.size();
+      head_keys.resize(k);
+      for(size_t i = 0; i < k; ++i) head_keys[i] = key_of(*runs[i].current);
+      tree.assign(k, k);
+      for(size_t i = k; i > 0;) replay(--i);
+      for(size_t n = total_size; n > 0; --n) {
+        const size_t w = tree[0];
+        Run& run = runs[w];
+        emit(*run.current, w);
+        if(++run.current != run.end) head_keys[w] = key_of(*run.current);
+        replay(w);
+      }
+    }
+
+    template<class KeyOf, class Emit>
+    void merge_by_sorting(KeyOf&& key_of, Emit&& emit)
+    {
+      keyed.clear();
+      items.clear();
+      for(size_t i = 0; i < runs.size(); ++i)
+        for(Iter it = runs[i].current; it != runs[i].end; ++it) {
+          keyed.emplace_back(key_of(*it), items.size());
+          items.emplace_back(*it, i);
+        }
+      // the second entries are the positions in the input, so sorting the pairs is stable with respect to the keys
+      std::sort(keyed.begin(), keyed.end());
+      for(const auto& [key, pos]: keyed) emit(items[pos].first, items[pos].second);
+    }
+
+  public:
+
+    void clear()
+    {
+      runs.clear();
+      total_size = 0;
+    }
+
+    // add a sorted run (empty runs are ignored)
+    void add_run(const Iter begin, const Iter end)
+    {
+      if(begin != end) {
+        runs.push_back({begin, end});
+        total_size += std::distance(begin, end);
+      }
+    }
+    template<class Container>
+    void add_run(const Container& c) { add_run(c.begin(), c.end()); }
+
+    size_t num_runs() const { return runs.size(); }
+    size_t size() const { return total_size; }
+
+    // call emit(item, run index) for all items of all runs in the order of their keys (given by key_of(item)), then forget the runs
+    //NOTE: the run index is the index among the non-empty runs that have been added
+    template<class KeyOf, class Emit>
+    void merge(KeyOf&& key_of, Emit&& emit)
+    {
+      if(runs.size() == 1) {
+        for(Iter it = runs.front().current; it != runs.front().end; ++it) emit(*it, 0);
+      } else if(runs.size() > 1) {
+        if(total_size <= config::kway_merge_sort_threshold)
+          merge_by_sorting(key_of, emit);
+        else
+          merge_by_tournament(key_of, emit);
+      }
+      clear();
+    }
+
+    // append all items of all runs to 'out' in the order of their keys, then forget the runs
+    template<class Container, class KeyOf>
+    void merge_into(Container& out, KeyOf&& key_of)
+    {
+      out.reserve(out.size() + total_size);
+      if(runs.size() <= config::vector_queue_merge_threshold) {
+        // for small fan-in, just merge the runs one by one
+        const size_t start = out.size();
+        for(const Run& run: runs) {
+          const size_t old_size = out.size();
+          out.insert(out.end(), run.current, run.end);
+          std::inplace_merge(out.begin() + start, out.begin() + old_size, out.end(),
+              [&](const auto& x, const auto& y) { return key_of(x) < key_of(y); });
+        }
+        clear();
+      } else merge(key_of, [&](const auto& x, size_t) { out.push_back(x); });
+    }
+  };
+
+}
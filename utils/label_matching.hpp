@@ -54,6 +54,14 @@ namespace PT {
         append(iter->second.first, p.first);
       }
       // step 2: for each node u with label l in T, add u to the set of T-nodes mapped to l
+      match_second(Tfac);
+    }
+
+    // for each (node, label) pair given by the iterator factory, add the node to the second part of the entry of the label
+    //NOTE: this allows building the first part once and then matching different second parts against (copies of) it
+    template<class NodeLabelContainerB>
+    void match_second(const NodeLabelContainerB& Tfac)
+    {
       for(const auto& p: Tfac) if(!p.second.empty()){
         // the factory Tfac gives us pairs of (node, label)
         auto& matched_pair = Parent::try_emplace(p.second).first->second;
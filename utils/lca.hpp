@@ -0,0 +1,98 @@
+#pragma once
+
+/*
+ * constant-time lowest common ancestor queries in a (static) tree
+ * we store the nodes of the tree in preorder and, for each range of 2^i consecutive positions in it, the position of a node of minimum
+ * depth in this range (a sparse table); if x comes before y in the preorder and x is not an ancestor of y, then the LCA of x and y is
+ * the parent of any node of minimum depth strictly after x and up to y in the preorder
+ * preprocessing takes O(n log n) time and space, each query takes O(1) time
+ */
+
+#include <vector>
+#include "utils.hpp"
+
+namespace PT{
+
+  template<class Tree>
+  class ConstantTimeLCA
+  {
+  public:
+    struct NodeInfo
+    {
+      uint32_t preorder_number;
+      uint32_t depth;
+      uint32_t subtree_size;
+    };
+
+  protected:
+    const Tree& tree;
+    NodeVec preorder;
+    std::vector<uint32_t> depth_at;  // the depth of the node at each position of the preorder
+    typename Tree::template NodeMap<NodeInfo> infos;
+    std::vector<std::vector<uint32_t>> min_depth_pos; // min_depth_pos[i][p] = position of a node of min depth in [p, p + 2^i)
+
+    static uint32_t log2(const size_t x) { return 8 * sizeof(unsigned long) - 1 - NUM_LEADING_ZEROSL(x); }
+
+    uint32_t min_depth_position(const uint32_t p, const uint32_t q) const
+    {
+      return (depth_at[p] <= depth_at[q]) ? p : q;
+    }
+
+  public:
+    ConstantTimeLCA(const Tree& _tree): tree(_tree)
+    {
+      if(tree.empty()) return;
+      const size_t n = tree.num_nodes();
+      preorder.reserve(n);
+      depth_at.reserve(n);
+      infos.reserve(n);
+      for(const Node x: tree.dfs().preorder()) {
+        const uint32_t x_depth = (x == tree.root()) ? 0 : infos.at(tree.parent(x)).depth + 1;
+        infos.try_emplace(x, NodeInfo{(uint32_t)preorder.size(), x_depth, 1});
+        preorder.push_back(x);
+        depth_at.push_back(x_depth);
+      }
+      // in reverse preorder, each node is seen after all its descendants, so we can accumulate the subtree sizes
+      for(auto iter = preorder.rbegin(); iter != preorder.rend(); ++iter)
+        if(*iter != tree.root()) infos.at(tree.parent(*iter)).subtree_size += infos.at(*iter).subtree_size;
+
+      min_depth_pos.reserve(log2(n) + 1);
+      min_depth_pos.emplace_back(n);
+      for(uint32_t p = 0; p < n; ++p) min_depth_pos[0][p] = p;
+      for(size_t i = 1, half = 1; 2 * half <= n; ++i, half *= 2) {
+        const auto& prev = min_depth_pos[i - 1];
+        std::vector<uint32_t>& current = min_depth_pos.emplace_back(n - 2 * half + 1);
+        for(size_t p = 0; p < current.size(); ++p)
+          current[p] = min_depth_position(prev[p], prev[p + half]);
+      }
+    }
+
+    const NodeInfo& info(const Node x) const { return infos.at(x); }
+    uint32_t preorder_number(const Node x) const { return infos.at(x).preorder_number; }
+    uint32_t depth(const Node x) const { return infos.at(x).depth; }
+    Node node_at(const size_t preorder_number) const { return preorder[preorder_number]; }
+
+    // return whether x is an ancestor of y (each node is an ancestor of itself)
+    bool is_ancestor(const Node x, const Node y) const
+    {
+      const NodeInfo& x_info = infos.at(x);
+      const uint32_t y_pre = infos.at(y).preorder_number;
+      return (x_info.preorder_number <= y_pre) && (y_pre < x_info.preorder_number + x_info.subtree_size);
+    }
+
+    Node LCA(const Node x, const Node y) const
+    {
+      if(x == y) return x;
+      uint32_t p = infos.at(x).preorder_number;
+      uint32_t q = infos.at(y).preorder_number;
+      if(p > q) std::swap(p, q);
+      // all nodes strictly after p and up to q are below the LCA, and those of minimum depth among them are children of the LCA
+      ++p;
+      const uint32_t i = log2(q - p + 1);
+      const uint32_t min_pos = min_depth_position(min_depth_pos[i][p], min_depth_pos[i][q + 1 - (1u << i)]);
+      return tree.parent(preorder[min_pos]);
+    }
+    Node operator()(const Node x, const Node y) const { return LCA(x, y); }
+  };
+
+}
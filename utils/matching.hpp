@@ -1,94 +1,188 @@
-
 #pragma once
 
-// an implementation of bipartite matching by Hopcroft-Karp (with some tweaks by me ;] )
+#include <vector>
+#include <algorithm>
+#include "utils.hpp"
+
+// an implementation of bipartite matching by Hopcroft-Karp on dense indices
+// the left side is {0, ..., num_left - 1}, the nodes on the right side can be any numbers (they are compacted before matching)
+// a BipartiteMatching is a workspace: clear() it and add the edges of the next graph, so its buffers are reused across calls
+//NOTE: when asking for a perfect matching, left nodes with at least num_left neighbors are matched last: whatever the other
+//      nodes are matched to, such a node still has a free neighbor, so it can never be the reason that no perfect matching exists
 
 namespace PT {
 
-  template<class Node,
-           class Adjacencies = std::unordered_map<Node, std::unordered_set<Node>>,
-           class Matching = std::unordered_map<Node, Node>>
-  class bipartite_matching
+  class BipartiteMatching
   {
-    // unmatched nodes are only interesting on the left
-    std::unordered_bitset left_unmatched;
-    std::unordered_bitset left_seen;
-    //NOTE: we need different matchings for left & right because the domains of the sides may overlap
-    Matching left_match, right_match;
-    
-    const Adjacencies& adj;
-
-    using NodeList = typename Adjacencies::mapped_type;
-    using adj_pair = decltype(*adj.begin());
-
-    // match a node u greedily in V (it's neighbors)
-    void initial_greedy_one_node(const adj_pair& uV)
+    static constexpr size_t none = SIZE_MAX;
+
+    size_t num_left = 0;
+    size_t num_right = 0;
+    std::vector<std::pair<size_t, size_t>> edges;
+    // the distinct right nodes (sorted), their index in this vector is their compact index
+    std::vector<size_t> right_nodes;
+    // adjacency lists of the left nodes (of compact right indices) in compressed form: the neighbors of u are adj[offsets[u]...offsets[u+1]-1]
+    std::vector<size_t> offsets;
+    std::vector<size_t> adj;
+
+    std::vector<size_t> left_match;
+    std::vector<size_t> right_match;
+    // BFS layer of each left node in the current phase (none = not reached), and the next edge to try in the DFS of each left node
+    std::vector<size_t> layer;
+    std::vector<size_t> next_edge;
+    std::vector<size_t> queue;
+    size_t matching_size = 0;
+
+    // nodes of degree at least this are matched only at the very end (see above)
+    size_t deferred_degree = SIZE_MAX;
+
+    size_t degree(const size_t u) const { return offsets[u + 1] - offsets[u]; }
+    bool deferred(const size_t u) const { return degree(u) >= deferred_degree; }
+
+    // compact the right nodes and build the adjacency lists; return whether each left node has a neighbor
+    bool build()
     {
-      const Node u = uV.first;
-      for(const Node v: uV.second){
-        if(right_match.emplace(v, u).second) {
-          left_match.emplace(u, v);
-          return;
-        }
+      right_nodes.clear();
+      for(const auto& uv: edges) right_nodes.push_back(uv.second);
+      std::sort(right_nodes.begin(), right_nodes.end());
+      right_nodes.erase(std::unique(right_nodes.begin(), right_nodes.end()), right_nodes.end());
+      num_right = right_nodes.size();
+
+      bool all_have_neighbors = true;
+      offsets.assign(num_left + 1, 0);
+      for(const auto& uv: edges) ++offsets[uv.first + 1];
+      for(size_t u = 0; u < num_left; ++u) {
+        all_have_neighbors &= (offsets[u + 1] != 0);
+        offsets[u + 1] += offsets[u];
       }
-      left_unmatched.set(u);
+      adj.resize(edges.size());
+      next_edge.assign(offsets.begin(), offsets.end() - 1);
+      for(const auto& [u, v]: edges)
+        adj[next_edge[u]++] = std::lower_bound(right_nodes.begin(), right_nodes.end(), v) - right_nodes.begin();
+      return all_have_neighbors;
     }
 
-    void initial_greedy() { for(const auto& uV: adj) initial_greedy_one_node(uV); }
-
-    // return whether the matching has been augmented, use 'seen' to indicate the visited nodes
-    //NOTE: u is a node on the left
-    bool augment_matching(const Node u)
+    // match u to any free neighbor; return whether there was one
+    bool match_greedily(const size_t u)
     {
-      if(!left_seen.set(u)) return false;
-      // if u is matched, ignore u's matching partner when looking for augmenting paths
-      const Node skip = map_lookup(left_match, u, NoNode);
-      for(const Node v: adj.at(u)) if(v != skip) {
-        // if v is not matched either, we can augment the matching with uv
-        const auto [v_match_it, success] = right_match.emplace(v, u);
-        if(success) {
-          // if v is unmatched, then insert uv in the matching
-          left_match.emplace(u, v);
+      for(size_t e = offsets[u]; e < offsets[u + 1]; ++e)
+        if(right_match[adj[e]] == none) {
+          left_match[u] = adj[e];
+          right_match[adj[e]] = u;
+          ++matching_size;
           return true;
-        } else if(augment_matching(v_match_it->second)){ // if v is matched, find an augmenting path from its matching partner
-          // if we found an augmenting path from v's matching partner, then flip it
+        }
+      return false;
+    }
+
+    void initial_greedy()
+    {
+      for(size_t u = 0; u < num_left; ++u)
+        if(!deferred(u)) match_greedily(u);
+    }
+
+    // BFS from all unmatched left nodes, alternating between non-matching and matching edges; return whether we reached an
+    // unmatched right node (that is, whether there is an augmenting path)
+    bool bfs()
+    {
+      layer.assign(num_left, none);
+      queue.clear();
+      for(size_t u = 0; u < num_left; ++u)
+        if((left_match[u] == none) && !deferred(u)) {
+          layer[u] = 0;
+          queue.push_back(u);
+        }
+      bool found = false;
+      for(size_t i = 0; i < queue.size(); ++i) {
+        const size_t u = queue[i];
+        for(size_t e = offsets[u]; e < offsets[u + 1]; ++e) {
+          const size_t w = right_match[adj[e]];
+          if(w == none) {
+            found = true;
+          } else if(layer[w] == none) {
+            layer[w] = layer[u] + 1;
+            queue.push_back(w);
+          }
+        }
+      }
+      return found;
+    }
+
+    // find an augmenting path from u along the BFS layers and flip it; return whether we found one
+    //NOTE: each edge is tried at most once per phase (next_edge), and dead ends are removed from the layers
+    bool dfs(const size_t u)
+    {
+      for(size_t& e = next_edge[u]; e < offsets[u + 1]; ++e) {
+        const size_t v = adj[e];
+        const size_t w = right_match[v];
+        if((w == none) || ((layer[w] == layer[u] + 1) && dfs(w))) {
           left_match[u] = v;
           right_match[v] = u;
+          ++e;
           return true;
         }
       }
+      layer[u] = none;
       return false;
     }
 
-    void compute_matching()
+    // compute a maximum matching (or, if we only want to know whether there is a perfect matching, give up as soon as it is clear
+    // that there is none) and return its size
+    size_t compute_matching(const bool want_perfect)
     {
-_start_here:
-      left_seen.clear();
-      for(const Node u: left_unmatched)
-        if(augment_matching(u)){
-          left_unmatched.unset(u);
-          goto _start_here;
-        }
-    }
+      const bool all_have_neighbors = build();
+      deferred_degree = want_perfect ? num_left : SIZE_MAX;
+      left_match.assign(num_left, none);
+      right_match.assign(num_right, none);
+      matching_size = 0;
+      // a left node without neighbors or too few right nodes make a perfect matching impossible
+      if(want_perfect && (!all_have_neighbors || (num_right < num_left))) return 0;
 
+      initial_greedy();
+      size_t num_deferred = 0;
+      for(size_t u = 0; u < num_left; ++u) num_deferred += deferred(u);
+      const size_t goal = num_left - num_deferred;
+      while((matching_size < goal) && bfs()) {
+        next_edge.assign(offsets.begin(), offsets.end() - 1);
+        size_t augmented = 0;
+        for(size_t u = 0; u < num_left; ++u)
+          if((left_match[u] == none) && !deferred(u) && dfs(u)) ++augmented;
+        if(augmented == 0) break;
+        matching_size += augmented;
+      }
+      // if all other nodes are matched, each deferred node is guaranteed to find a free neighbor
+      if(matching_size == goal)
+        for(size_t u = 0; u < num_left; ++u)
+          if(deferred(u)) match_greedily(u);
+      return matching_size;
+    }
 
   public:
 
-    bipartite_matching(const Adjacencies& _adj): adj(_adj)
-    { 
-      initial_greedy(); 
-      std::cout << "computing matching for "<<adj<<" (starting with greedy "<<left_match<<")\n";
+    // start a new graph with the given number of left nodes
+    void clear(const size_t _num_left)
+    {
+      num_left = _num_left;
+      edges.clear();
     }
 
-    // after initial_greedy, the matching is maximal (not maximum)
-    const Matching& maximal_matching() const
-    { return left_match; }
-
-    const Matching& maximum_matching()
+    void add_edge(const size_t left, const size_t right)
     {
-      compute_matching();
-      return left_match;
+      assert(left < num_left);
+      edges.emplace_back(left, right);
     }
 
+    // return the size of a maximum matching
+    size_t maximum_matching() { return compute_matching(false); }
+
+    // return whether all left nodes can be matched
+    bool has_perfect_matching() { return compute_matching(true) == num_left; }
+
+    // the right node that the left node u is matched to in the last matching that we computed (or SIZE_MAX if u is unmatched)
+    size_t matched_to(const size_t u) const
+    {
+      const size_t v = left_match[u];
+      return (v == none) ? none : right_nodes[v];
+    }
   };
 }
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "utils.hpp"
+#include "network.hpp"
+#include "worklist.hpp"
+#include "containment.hpp"
+#include "transposition_table.hpp"
+#include "search_budget.hpp"
+#include "displayed_trees.hpp"
+
+/*
+ * containment of a guest network in a host network: the host contains the guest if it displays each tree displayed by the guest
+ * (the trees obtained by choosing one parent for each reticulation of the guest and removing the other reticulation arcs)
+ * the naive way to decide this is to enumerate all displayed trees of the guest and check each of them (see NetInNetContainment::decide_by_enumeration()),
+ * which takes time exponential in the number of reticulations of the guest, even if most choices lead to the same tree
+ * instead, we apply reduction rules to the guest that do not change the set of trees it displays (the guest-side versions of the
+ * reticulation merger and the triangle rule of containment.hpp) and branch on the parents of a reticulation only when the rules are
+ * exhausted; each branch gets a reduced copy of the guest and all branches have to succeed; branches whose guest has been seen before
+ * (up to node indices and the order of children) are skipped, and the trees at the leaves of the search are checked by a
+ * TreeInNetBatchContainment, so the host is preprocessed only once
+ */
+
+namespace PT{
+
+  // copy the parents of x into a vector, so we can modify the network while going through them
+  template<class Network>
+  NodeVec parents_of(const Network& N, const Node x)
+  {
+    const auto& x_parents = N.parents(x);
+    return NodeVec(x_parents.begin(), x_parents.end());
+  }
+
+  struct NetContainmentStats
+  {
+    size_t trees_checked = 0;        // number of trees given to the tree-containment engine
+    size_t branchings = 0;           // number of guest reticulations we branched on
+    size_t duplicates = 0;           // number of branches skipped because their guest has been seen before
+    size_t merged_retis = 0;         // number of guest reticulations merged into their reticulation child
+    size_t triangles = 0;            // number of reticulation arcs removed by the triangle rule
+    size_t common_cherries = 0;      // number of leaves removed from host and guest by the common-cherry rule
+
+    friend std::ostream& operator<<(std::ostream& os, const NetContainmentStats& s)
+    {
+      return os << s.trees_checked << " trees checked, " << s.branchings << " branchings, " << s.duplicates << " duplicate branches, "
+                << s.merged_retis << " reticulations merged, " << s.triangles << " triangles reduced, "
+                << s.common_cherries << " common cherries reduced";
+    }
+  };
+
+  // reductions of a network that keep the set of trees it displays (we apply them to the guest and, before branching, to the host)
+  //NOTE: all reductions here also count themselves in the given stats
+  template<class Network>
+  struct DisplayedTreesReducer
+  {
+    Network& guest;
+    NetContainmentStats& stats;
+    NodeWorklist todo;
+
+    DisplayedTreesReducer(Network& _guest, NetContainmentStats& _stats): guest(_guest), stats(_stats) {}
+
+    void add(const Node x) { todo.push(x); }
+    template<class Container>
+    void add_all(const Container& c) { for(const Node x: c) todo.push(x); }
+
+    // apply all reductions to all nodes that were added (and to all nodes whose neighborhood changed in the process)
+    void apply()
+    {
+      while(!todo.empty()) {
+        const Node x = todo.pop();
+        if(guest.has_node(x)) reduce(x);
+      }
+    }
+
+    // apply all reductions to the whole guest
+    void apply_all()
+    {
+      for(const Node x: guest.nodes()) add(x);
+      apply();
+    }
+
+  protected:
+    void reduce(const Node x)
+    {
+      switch(guest.out_degree(x)){
+        case 0:
+          // leaves without label appear when all children of a node lost their reticulation arcs, they are in no displayed tree
+          if(!guest.has_label(x) || guest.label(x).empty()) {
+            const NodeVec x_parents = parents_of(guest, x);
+            guest.remove_node(x);
+            add_all(x_parents);
+          }
+          break;
+        case 1: {
+            const Node y = guest.any_child(x);
+            if(guest.in_degree(x) <= 1) {
+              // suppress x (if x is the root, then its child becomes the root)
+              const NodeVec x_parents = parents_of(guest, x);
+              guest.contract_downwards(x, y);
+              add(y);
+              add_all(x_parents);
+            } else if constexpr(Network::is_declared_tree) {
+              // the remaining rules concern reticulations, which trees don't have
+            } else if((guest.out_degree(y) == 1) && (guest.in_degree(y) > 1)) {
+              // reticulation merger: if x and its child y are both reticulations, then choosing a parent of y and (if this is x) a
+              // parent of x is the same as choosing a parent of x or a parent of y other than x
+              DEBUG3(std::cout << "merging reticulation "<<x<<" into its reticulation child "<<y<<"\n");
+              const NodeVec x_parents = parents_of(guest, x);
+              guest.contract_downwards(x, y);
+              ++stats.merged_retis;
+              add(y);
+              add_all(x_parents);
+            } else if(triangle_rule(x)) add(x);
+          }
+          break;
+        default:
+          if constexpr(!Network::is_declared_tree)
+            if(guest.in_degree(x) > 1) triangle_rule(x);
+      }
+    }
+
+    // triangle rule: if z has 2 parents x and y such that xy is an arc and x & y have out-degree 2 and y has in-degree 1,
+    // then choosing x or y as parent of z leads to the same tree (z and the other child of y form a cherry below x),
+    // so we can remove the arc xz; return whether we did
+    bool triangle_rule(const Node z)
+    {
+      for(const Node y: guest.parents(z)) {
+        if((guest.in_degree(y) == 1) && (guest.out_degree(y) == 2)) {
+          const Node x = guest.parent(y);
+          if((guest.out_degree(x) == 2) && test(guest.parents(z), x)) {
+            DEBUG3(std::cout << "triangle "<<x<<" -> "<<y<<" -> "<<z<<": removing arc "<<x<<" -> "<<z<<"\n");
+            guest.remove_edge(x, z);
+            ++stats.triangles;
+            add(x);
+            add(z);
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+  };
+
+  // turn the guest network into the network in which z has only the parent p (by removing all other arcs into z), then reduce it
+  template<class Guest>
+  void keep_only_parent(Guest& guest, const Node z, const Node p, NetContainmentStats& stats)
+  {
+    DisplayedTreesReducer<Guest> reducer(guest, stats);
+    const NodeVec z_parents = parents_of(guest, z);
+    for(const Node q: z_parents)
+      if(q != p) {
+        guest.remove_edge(q, z);
+        reducer.add(q);
+      }
+    reducer.add(z);
+    reducer.apply();
+  }
+
+
+
+  // common-cherry rule: if the leaves a and b form a cherry in both the host and the guest (their parent has out-degree 2 and they
+  // have in-degree 1), then they form a cherry in all trees displayed by either of them, so the host displays all trees displayed by
+  // the guest if and only if this holds after removing b from both; return the number of leaves removed
+  //NOTE: the rule needs to modify the host, so we apply it once before the host is preprocessed
+  //NOTE: we keep at least 2 leaves in the guest, since the tree-containment engine cannot handle single-leaf trees
+  template<class Host, class Guest>
+  size_t reduce_common_cherries(Host& host, Guest& guest, NetContainmentStats& stats)
+  {
+    using LabelType = std::remove_cvref_t<typename Host::LabelType>;
+    HashMap<LabelType, Node> host_leaves;
+    for(const Node x: host.leaves()) if(host.has_label(x)) host_leaves.try_emplace(host.label(x), x);
+
+    // return the sibling of the leaf x in the cherry it forms in N, or NoNode if it's not in a cherry
+    const auto cherry_sibling = [](const auto& N, const Node x) -> Node {
+      if(N.in_degree(x) != 1) return NoNode;
+      const Node p = N.parent(x);
+      if(N.out_degree(p) != 2) return NoNode;
+      for(const Node y: N.children(p))
+        if((y != x) && N.is_leaf(y) && (N.in_degree(y) == 1)) return y;
+      return NoNode;
+    };
+    const auto host_leaf = [&](const auto& label) -> Node {
+      const auto iter = host_leaves.find(label);
+      return (iter != host_leaves.end()) ? iter->second : NoNode;
+    };
+
+    size_t removed = 0;
+    size_t num_guest_leaves = 0;
+    NodeWorklist todo;
+    for(const Node x: guest.leaves()) { todo.push(x); ++num_guest_leaves; }
+    while(!todo.empty() && (num_guest_leaves > 2)) {
+      const Node a = todo.pop();
+      if(!guest.has_node(a) || !guest.has_label(a)) continue;
+      const Node b = cherry_sibling(guest, a);
+      if((b == NoNode) || !guest.has_label(b)) continue;
+      const Node host_a = host_leaf(guest.label(a));
+      const Node host_b = host_leaf(guest.label(b));
+      if((host_a == NoNode) || (host_b == NoNode) || (cherry_sibling(host, host_a) != host_b)) continue;
+
+      DEBUG3(std::cout << "removing leaf "<<b<<" of common cherry {"<<a<<","<<b<<"} from host and guest\n");
+      const Node host_p = host.parent(host_b);
+      const Node guest_p = guest.parent(b);
+      host_leaves.erase(guest.label(b));
+      host.remove_node(host_b, true);
+      guest.remove_node(b, true);
+      DisplayedTreesReducer<Host> host_reducer(host, stats);
+      host_reducer.add(host_p);
+      host_reducer.apply();
+      DisplayedTreesReducer<Guest> guest_reducer(guest, stats);
+      guest_reducer.add(guest_p);
+      guest_reducer.apply();
+      ++removed;
+      --num_guest_leaves;
+      // a may form a cherry with its new sibling now
+      todo.push(a);
+    }
+    stats.common_cherries += removed;
+    return removed;
+  }
+
+
+
+  template<class Host, class Guest, bool leaf_labels_only = true>
+  class NetInNetContainment
+  {
+  public:
+    using RWGuest = CompatibleRWNetwork<Guest>;
+    using GuestTree = CompatibleRWTree<Guest>;
+    using Batch = TreeInNetBatchContainment<Host, GuestTree, leaf_labels_only>;
+    using Configurator = typename Batch::Configurator;
+    using RWHost = typename Batch::RWHost;
+
+  protected:
+    NetContainmentStats stats;
+    RWGuest guest;
+    Batch batch;
+    std::shared_ptr<SearchBudget> budget;
+
+    // reduce the host together with the guest (see reduce_common_cherries()), before the batch preprocesses it
+    RWHost&& prepare_host(RWHost&& host)
+    {
+      DisplayedTreesReducer<RWHost>(host, stats).apply_all();
+      DisplayedTreesReducer<RWGuest>(guest, stats).apply_all();
+      reduce_common_cherries(host, guest, stats);
+      return std::move(host);
+    }
+
+    // check a displayed tree of the guest
+    Verdict decide_tree(const GuestTree& tree_guest, const Configurator& configure)
+    {
+      ++stats.trees_checked;
+      DEBUG5(std::cout << "checking displayed tree of the guest:\n"<<tree_guest<<"\n");
+      return batch.decide(tree_guest, configure);
+    }
+
+  public:
+
+    template<class _Host, class _Guest>
+    NetInNetContainment(_Host&& _host, _Guest&& _guest):
+      guest(std::forward<_Guest>(_guest)),
+      batch(prepare_host(RWHost(std::forward<_Host>(_host))))
+    {}
+
+    // give up once the budget has run out (the budget is also given to the tree-containment engine for each tree)
+    void use_budget(std::shared_ptr<SearchBudget> _budget) { budget = std::move(_budget); }
+    const std::shared_ptr<SearchBudget>& get_budget() const { return budget; }
+    const NetContainmentStats& get_stats() const { return stats; }
+    Batch& get_batch() { return batch; }
+
+    // decide whether the host displays all trees displayed by the guest
+    //NOTE: 'configure' is applied to each tree-containment engine before it starts (see TreeInNetBatchContainment)
+    Verdict decide(const Configurator& configure = {})
+    {
+      const Configurator configure_with_budget = [&](auto& tc) {
+        if(configure) configure(tc);
+        if(budget) tc.use_budget(budget);
+      };
+      HashSet<Fingerprint, FingerprintHash> seen;
+      std::vector<RWGuest> branches;
+      branches.push_back(guest);
+      DisplayedTreesReducer<RWGuest>(branches.back(), stats).apply_all();
+
+      bool gave_up = false;
+      while(!branches.empty()) {
+        if(budget && budget->exhausted()) return Verdict::unknown;
+        RWGuest current = value_pop_back(branches);
+        if(!seen.insert(structural_fingerprint(current, leaf_labels_only)).second) {
+          ++stats.duplicates;
+          continue;
+        }
+        if(current.is_tree()) {
+          switch(decide_tree(GuestTree(current), configure_with_budget)){
+            case Verdict::not_displayed: return Verdict::not_displayed;
+            case Verdict::unknown: gave_up = true; break;
+            default: break;
+          }
+        } else {
+          // branch on the parents of a lowest reticulation (such that the subnetwork below it is a tree)
+          Node z = NoNode;
+          for(const Node x: current.dfs().postorder())
+            if(current.in_degree(x) > 1) { z = x; break; }
+          assert(z != NoNode);
+          if(budget && !budget->count_branch_node()) return Verdict::unknown;
+          ++stats.branchings;
+          const NodeVec z_parents = parents_of(current, z);
+          DEBUG3(std::cout << "branching on the "<<z_parents.size()<<" parents of guest reticulation "<<z<<"\n");
+          for(size_t i = 0; i < z_parents.size(); ++i) {
+            RWGuest& branch = (i + 1 < z_parents.size()) ? branches.emplace_back(current) : branches.emplace_back(std::move(current));
+            keep_only_parent(branch, z, z_parents[i], stats);
+          }
+        }
+      }
+      return gave_up ? Verdict::unknown : Verdict::displayed;
+    }
+
+    bool displayed(const Configurator& configure = {}) { return decide(configure) == Verdict::displayed; }
+
+    // for comparison: decide containment of the guest by enumerating all of its distinct displayed trees and checking each of them
+    Verdict decide_by_enumeration(const Configurator& configure = {})
+    {
+      const Configurator configure_with_budget = [&](auto& tc) {
+        if(configure) configure(tc);
+        if(budget) tc.use_budget(budget);
+      };
+      DisplayedTreeEnumerator<RWGuest, GuestTree, leaf_labels_only> displayed_trees(guest);
+      bool gave_up = false;
+      for(const GuestTree& tree_guest: displayed_trees) {
+        if(budget && budget->exhausted()) return Verdict::unknown;
+        switch(decide_tree(tree_guest, configure_with_budget)){
+          case Verdict::not_displayed: return Verdict::not_displayed;
+          case Verdict::unknown: gave_up = true; break;
+          default: break;
+        }
+      }
+      stats.duplicates += displayed_trees.get_stats().duplicates;
+      return gave_up ? Verdict::unknown : Verdict::displayed;
+    }
+  };
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <condition_variable>
+#include "utils.hpp"
+
+/*
+ * building blocks for pipelines whose stages run concurrently (f.ex. reading -> parsing -> computing -> writing):
+ * stages are connected by BoundedQueues, so fast stages block instead of piling up items in memory, and
+ * the last stage can use a ReorderBuffer to handle items in the order in which they entered the pipeline
+ */
+
+namespace PT{
+
+  // a FIFO queue holding at most 'capacity' items; push() blocks while the queue is full and pop() blocks while it is empty
+  // once the producers are done, they close() the queue, after which pop() returns the remaining items and then nothing
+  template<class T>
+  class BoundedQueue
+  {
+    std::deque<T> items;
+    const size_t capacity;
+    bool closed = false;
+    std::mutex lock;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+  public:
+    BoundedQueue(const size_t _capacity): capacity(std::max(_capacity, size_t(1))) {}
+    BoundedQueue(const BoundedQueue&) = delete;
+
+    // return false if the queue has been closed (in which case x is not pushed)
+    bool push(T x)
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      not_full.wait(guard, [this]{ return closed || (items.size() < capacity); });
+      if(closed) return false;
+      items.push_back(std::move(x));
+      guard.unlock();
+      not_empty.notify_one();
+      return true;
+    }
+
+    // return nothing if the queue has been closed and there are no more items
+    std::optional<T> pop()
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      not_empty.wait(guard, [this]{ return closed || !items.empty(); });
+      if(items.empty()) return std::nullopt;
+      std::optional<T> result(std::move(items.front()));
+      items.pop_front();
+      guard.unlock();
+      not_full.notify_one();
+      return result;
+    }
+
+    void close()
+    {
+      {
+        const std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+      }
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+  };
+
+  // a buffer that receives items numbered 0,1,2,... in any order and hands them out in order
+  // to keep the memory bounded, put() blocks while the item is more than 'window' positions ahead of the next item to hand out
+  //NOTE: the next item to hand out can always be put, so this never deadlocks as long as each number is put exactly once
+  template<class T>
+  class ReorderBuffer
+  {
+    std::deque<std::optional<T>> pending; // pending[i] holds item number next + i (if it arrived already)
+    const size_t window;
+    size_t next = 0;
+    bool closed = false;
+    std::mutex lock;
+    std::condition_variable has_room;
+    std::condition_variable has_next;
+
+  public:
+    ReorderBuffer(const size_t _window): window(std::max(_window, size_t(1))) {}
+    ReorderBuffer(const ReorderBuffer&) = delete;
+
+    void put(const size_t number, T x)
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      assert(number >= next);
+      has_room.wait(guard, [&]{ return number < next + window; });
+      const size_t offset = number - next;
+      if(pending.size() <= offset) pending.resize(offset + 1);
+      pending[offset].emplace(std::move(x));
+      if(offset == 0) {
+        guard.unlock();
+        has_next.notify_one();
+      }
+    }
+
+    // get the next item in order; return nothing if the buffer has been closed and the next item is not there
+    std::optional<T> get()
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      has_next.wait(guard, [this]{ return closed || (!pending.empty() && pending.front()); });
+      if(pending.empty() || !pending.front()) return std::nullopt;
+      std::optional<T> result(std::move(pending.front()));
+      pending.pop_front();
+      ++next;
+      guard.unlock();
+      has_room.notify_all();
+      return result;
+    }
+
+    // close the buffer once all items have been put
+    void close()
+    {
+      {
+        const std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+      }
+      has_next.notify_all();
+    }
+  };
+
+}
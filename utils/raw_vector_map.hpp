@@ -111,6 +111,13 @@ namespace std {
       insert(first, last);
     }
 
+    // make room for the index x_idx; grow the capacity geometrically, so inserting keys in increasing order takes amortized constant time
+    void reserve_index(const size_t x_idx)
+    {
+      if(x_idx >= Parent::capacity())
+        Parent::reserve(std::max(x_idx + 1, 2 * Parent::capacity()));
+    }
+
     // ATTENTION: ERASE DOES NOT NECCESSARILY DO WHAT YOU EXPECT!
     // erase will just reinisialize x to the default element
     // if this is not what you want, you probably want to use vector_map from vector_map2.hpp
@@ -122,7 +129,7 @@ namespace std {
     {
       while(first != last){
         if(first->first >= size()) {
-          Parent::reserve(first->first + 1);
+          reserve_index(first->first);
           Parent::resize(first->first);
           Parent::emplace_back(first->second);
         } else operator[](first->first) = first->second;
@@ -137,7 +144,7 @@ namespace std {
     {
       const size_t x_idx = (size_t)x;
       if(x_idx >= size()) {
-        Parent::reserve(x_idx + 1);
+        reserve_index(x_idx);
         Parent::resize(x_idx);
         Parent::emplace_back(forward<Args>(args)...);
         return { {data(), x_idx}, true };
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <mutex>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils.hpp"
+#include "config.hpp"
+#include "transposition_table.hpp"
+#include "search_budget.hpp"
+
+/*
+ * a persistent cache of containment results, living in a memory-mapped file, so that the same (host, guest) pair does not have to be
+ * checked again in later runs (or by other processes running at the same time)
+ * pairs are identified by their structural fingerprints (see transposition_table.hpp), which do not depend on node indices or on the
+ * order of children in the input, so the same pair is recognized no matter how it is written down
+ * the file is an open-addressing hash table with a fixed number of slots; when all slots that a fingerprint may occupy are taken,
+ * an old entry is overwritten, so the cache never grows beyond its initial size
+ * each entry carries the version of the results it stores, so bumping the version invalidates all old entries,
+ * and a checksum, so entries that were half-written by a crashing process are ignored
+ * readers and writers from different processes are synchronized by file locks (flock), threads of the same process by a mutex
+ */
+
+namespace PT{
+
+  // a fingerprint of a (host, guest) pair that is independent of node indices and the order of children
+  template<class Host, class Guest>
+  Fingerprint containment_fingerprint(const Host& host, const Guest& guest, const bool leaf_labels_only = true)
+  {
+    Fingerprint fp = structural_fingerprint(host, leaf_labels_only);
+    return fp += structural_fingerprint(guest, leaf_labels_only);
+  }
+
+  class ResultCache
+  {
+  public:
+    // the version of the results that we store; increase this whenever results computed by older code may be wrong
+    static constexpr uint32_t default_version = 1;
+
+  protected:
+    // the layout of the file; increase this whenever Header or Slot change
+    static constexpr uint64_t magic = 0x454843414354505FULL; // "_PTCACHE"
+    static constexpr uint32_t format = 1;
+    // the number of consecutive slots in which we look for a fingerprint
+    static constexpr size_t max_probes = 8;
+
+    struct Header
+    {
+      uint64_t magic;
+      uint32_t format;
+      uint32_t reserved;
+      uint64_t num_slots;
+    };
+
+    struct Slot
+    {
+      uint64_t fp_first;
+      uint64_t fp_second;
+      uint32_t version;  // 0 = empty
+      uint32_t value;
+      uint64_t checksum;
+
+      uint64_t compute_checksum() const { return uint64_hash(fp_first ^ uint64_hash(fp_second + ((uint64_t)version << 32) + value)); }
+      bool valid() const { return (version != 0) && (checksum == compute_checksum()); }
+      bool holds(const Fingerprint& fp) const { return (fp_first == fp.first) && (fp_second == fp.second) && valid(); }
+    };
+    static_assert(std::is_trivially_copyable_v<Slot>);
+
+    const std::string filename;
+    const uint32_t version;
+    int fd = -1;
+    size_t num_slots = 0;
+    size_t map_size = 0;
+    char* map = nullptr;
+    Slot* slots = nullptr;
+
+    std::mutex lock;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stores = 0;
+
+    // hold a file lock (shared or exclusive) for as long as this object lives
+    struct FileLock
+    {
+      const int fd;
+      FileLock(const int _fd, const int operation): fd(_fd) { while((flock(fd, operation) == -1) && (errno == EINTR)); }
+      ~FileLock() { flock(fd, LOCK_UN); }
+    };
+
+    [[noreturn]] void fail(const std::string& what, const bool system_error = true) const
+    {
+      throw std::runtime_error("result cache " + filename + ": " + what + (system_error ? std::string(" (") + std::strerror(errno) + ")" : ""));
+    }
+
+    // create the file if it is empty, or check that it is a cache file that we can read
+    void open_file(const size_t requested_slots)
+    {
+      fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+      if(fd == -1) fail("cannot be opened");
+      const FileLock guard(fd, LOCK_EX);
+      struct stat st;
+      if(fstat(fd, &st) == -1) fail("cannot be inspected");
+      Header header;
+      if(st.st_size == 0) {
+        header = {magic, format, 0, std::max(requested_slots, max_probes)};
+        if(ftruncate(fd, sizeof(Header) + header.num_slots * sizeof(Slot)) == -1) fail("cannot be resized");
+        if(pwrite(fd, &header, sizeof(Header), 0) != sizeof(Header)) fail("cannot be written");
+      } else {
+        if((pread(fd, &header, sizeof(Header), 0) != sizeof(Header)) || (header.magic != magic))
+          fail("is not a result cache", false);
+        if(header.format != format)
+          fail("has format " + std::to_string(header.format) + " instead of " + std::to_string(format), false);
+        if((size_t)st.st_size != sizeof(Header) + header.num_slots * sizeof(Slot)) fail("has the wrong size", false);
+      }
+      num_slots = header.num_slots;
+    }
+
+    // return the slot containing fp or, if there is none, nullptr
+    const Slot* find(const Fingerprint& fp) const
+    {
+      for(size_t i = 0; i < max_probes; ++i) {
+        const Slot& slot = slots[(fp.first + i) % num_slots];
+        if(slot.holds(fp)) return &slot;
+      }
+      return nullptr;
+    }
+
+  public:
+
+    // open the cache in the given file, creating it with the given number of slots if it does not exist
+    //NOTE: if the file exists, its number of slots is used
+    ResultCache(const std::string& _filename, const size_t requested_slots = config::result_cache_slots, const uint32_t _version = default_version):
+      filename(_filename), version(_version)
+    {
+      if(version == 0) throw std::logic_error("result cache versions start at 1");
+      try{
+        open_file(requested_slots);
+        map_size = sizeof(Header) + num_slots * sizeof(Slot);
+        void* const addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(addr == MAP_FAILED) fail("cannot be mapped into memory");
+        map = static_cast<char*>(addr);
+      } catch(...) {
+        if(fd != -1) ::close(fd);
+        throw;
+      }
+      slots = reinterpret_cast<Slot*>(map + sizeof(Header));
+    }
+
+    ResultCache(const ResultCache&) = delete;
+
+    ~ResultCache()
+    {
+      if(map) munmap(map, map_size);
+      if(fd != -1) ::close(fd);
+    }
+
+    // look up the result for the given fingerprint and copy it into 'displayed'; return whether we found it
+    bool lookup(const Fingerprint& fp, bool& displayed)
+    {
+      const std::lock_guard<std::mutex> guard(lock);
+      const FileLock file_guard(fd, LOCK_SH);
+      const Slot* const slot = find(fp);
+      if(slot && (slot->version == version)) {
+        ++hits;
+        displayed = slot->value;
+        return true;
+      } else {
+        ++misses;
+        return false;
+      }
+    }
+
+    void insert(const Fingerprint& fp, const bool displayed)
+    {
+      const std::lock_guard<std::mutex> guard(lock);
+      const FileLock file_guard(fd, LOCK_EX);
+      // overwrite the slot with fp or the first empty (or invalid or outdated) slot; if there is none, evict one of the candidates
+      Slot* target = const_cast<Slot*>(find(fp));
+      for(size_t i = 0; !target && (i < max_probes); ++i) {
+        Slot& slot = slots[(fp.first + i) % num_slots];
+        if(!slot.valid() || (slot.version != version)) target = &slot;
+      }
+      if(!target) target = &slots[(fp.first + fp.second % max_probes) % num_slots];
+      Slot entry{fp.first, fp.second, version, displayed, 0};
+      entry.checksum = entry.compute_checksum();
+      *target = entry;
+      ++stores;
+    }
+
+    // look up the verdict for the pair with the given fingerprint; if we don't know it, compute it using 'compute' and remember it
+    //NOTE: 'unknown' verdicts (from searches that ran out of budget) are not remembered
+    template<class Compute>
+    Verdict decide(const Fingerprint& fp, Compute&& compute)
+    {
+      bool displayed;
+      if(lookup(fp, displayed)) return displayed ? Verdict::displayed : Verdict::not_displayed;
+      const Verdict result = compute();
+      if(result != Verdict::unknown) insert(fp, result == Verdict::displayed);
+      return result;
+    }
+
+    size_t get_num_slots() const { return num_slots; }
+    uint32_t get_version() const { return version; }
+    size_t num_hits() { const std::lock_guard<std::mutex> guard(lock); return hits; }
+    size_t num_misses() { const std::lock_guard<std::mutex> guard(lock); return misses; }
+    size_t num_stores() { const std::lock_guard<std::mutex> guard(lock); return stores; }
+
+    friend std::ostream& operator<<(std::ostream& os, ResultCache& rc)
+    {
+      const std::lock_guard<std::mutex> guard(rc.lock);
+      return os << rc.filename << " (" << rc.num_slots << " slots, version " << rc.version << "): "
+                << rc.hits << " hits, " << rc.misses << " misses, " << rc.stores << " stores";
+    }
+  };
+
+}
@@ -1,12 +1,16 @@
 
 #pragma once
 
+#include <deque>
+#include <limits>
 #include "set_interface.hpp"
 #include "extension.hpp"
 #include "tree_extension.hpp"
 #include "bridges.hpp"
 #include "subsets_constraint.hpp"
 #include "biconnected_comps.hpp"
+#include "bitmask.hpp"
+#include "thread_pool.hpp"
 
 namespace PT{
 
@@ -20,6 +24,13 @@ namespace PT{
     sw_t get_scanwidth(const _Network& N) const { return ex.scanwidth(N); }
     // update entry with the next node u
     void update(const _Network& N, const Node u) { append(ex, u); }
+    // the scanwidth of the entry if it was updated with u (and u's suppressible ancestors, which get the same scanwidth as u)
+    sw_t scanwidth_with(const _Network& N, const Node u) const
+    {
+      Extension bigger(ex);
+      append(bigger, u);
+      return bigger.scanwidth(N);
+    }
   };
 
   // this DP table entry stores alot of stuff in order to avoid re-computing the scanwidth each time (good if you have plenty of mem, but not much time)
@@ -41,6 +52,23 @@ namespace PT{
       Parent::update(N, u);
       scanwidth = std::max(scanwidth, ex.update_sw(N, u, weak_components, sw_map));
     }
+    // the scanwidth of the entry if it was updated with u (and u's suppressible ancestors, which get the same scanwidth as u),
+    // computed without copying the entry: appending u merges the weak components of its out-arcs, which lose the out-arcs and gain
+    // the in-arcs of u (see Extension::update_sw())
+    sw_t scanwidth_with(const _Network& N, const Node u) const
+    {
+      sw_t u_sw = N.in_degree(u);
+      const auto u_out = N.out_edges(u);
+      for(auto i = u_out.begin(); i != u_out.end(); ++i) {
+        const auto& i_set = weak_components.peek_set_of(*i);
+        // count each component only once (u has only a few out-arcs, so we just compare with all previous ones)
+        bool first = true;
+        for(auto j = u_out.begin(); first && (j != i); ++j)
+          first = (weak_components.peek_set_of(*j) != i_set);
+        if(first) u_sw += i_set.size();
+      }
+      return std::max<sw_t>(scanwidth, u_sw - N.out_degree(u));
+    }
   };
 
 
@@ -51,22 +79,221 @@ namespace PT{
   {
   public:
     using DPEntry = typename std::conditional_t<low_memory_version, _DPEntryLowMem<_Network>, _DPEntry<_Network>>;
+    // the largest blocks we can handle (in number of non-suppressible nodes)
+    static constexpr size_t max_nodes = FixedBitmask<16>::capacity;
  
   protected:
-    using DPTable = std::unordered_map<HashSet<Node>, DPEntry, std::set_hash<HashSet<Node>>>;
+    // the DP table maps sets of (relabeled) nodes to DP entries
+    template<size_t words>
+    using DPTable = BitmaskMap<FixedBitmask<words>, DPEntry>;
     
     const _Network& N;
     const bool ignore_deg2;
-    DPTable dp_table;
+    // if we have a thread pool, the DP goes through the node sets by size and treats the sets of each size in parallel
+    std::shared_ptr<WorkStealingPool> pool;
+    // node sets whose best partial extension has at least this scanwidth are pruned, so the DP only finds extensions of smaller width
+    sw_t upper_bound = std::numeric_limits<sw_t>::max();
+    uint64_t num_pruned = 0;
+
+    // the non-suppressible nodes of N, relabeled into 0, ..., k-1
+    DenseNodeIndex nodes;
+    // for each node (by its new label), the labels of its parents (skipping suppressible nodes if ignore_deg2 is set)
+    std::vector<std::vector<uint32_t>> parents;
+    // for each node (by its new label), the labels of its children (skipping suppressible nodes)
+    std::vector<std::vector<uint32_t>> children;
+    // for each node (by its new label), its suppressible ancestors in the order in which they are appended after it
+    std::vector<NodeVec> deg2_ancestors;
 
-    // return whether u is a root in N[c], that is, if u has parents in c
-    inline bool is_root_in_set(const Node u, const HashSet<Node>& c)
+    void relabel_nodes()
     {
-      for(auto v: N.parents(u)){
-        // ignore deg-2 nodes
-        if(ignore_deg2) while(N.is_suppressible(v)) v = std::front(N.parents(v));
-        if(test(c, v)) return false;
+      for(const Node u: N.nodes())
+        if(!N.is_suppressible(u)) nodes.add(u);
+      parents.resize(nodes.size());
+      children.resize(nodes.size());
+      deg2_ancestors.resize(nodes.size());
+      for(size_t i = 0; i < nodes.size(); ++i) {
+        const Node u = nodes.node(i);
+        for(Node v: N.parents(u)){
+          // ignore deg-2 nodes
+          if(ignore_deg2) while(N.is_suppressible(v)) v = std::front(N.parents(v));
+          // if we don't ignore deg-2 nodes, then a deg-2 parent is never in a set, so it never prevents u from being a root
+          if(!N.is_suppressible(v)) parents[i].push_back(nodes[v]);
+        }
+        for(Node v: N.children(u)){
+          while(N.is_suppressible(v)) v = std::front(N.children(v));
+          children[i].push_back(nodes[v]);
+        }
+        for(Node v: N.parents(u))
+          while(N.is_suppressible(v)){
+            deg2_ancestors[i].push_back(v);
+            v = N.parent(v);
+          }
       }
+    }
+
+    // return whether u is a root in N[c], that is, if u has no parents in c
+    template<class Mask>
+    inline bool is_root_in_set(const size_t u, const Mask& c) const
+    {
+      for(const uint32_t v: parents[u])
+        if(c.test(v)) return false;
+      return true;
+    }
+
+    // compute the best entry for the given set of nodes from the entries of the sets with one node less (which have to be in 'table',
+    // unless they have been pruned) and return its scanwidth (if this is not below the upper bound, best_entry is not set)
+    template<class Mask, class Table>
+    sw_t compute_entry(const Mask& set, const Table& table, DPEntry& best_entry) const
+    {
+      sw_t best_sw = std::min<size_t>(upper_bound, N.num_nodes() + 1);
+      const DPEntry* best_smaller_entry = nullptr;
+      size_t best_u = 0;
+      // for each node u in the set, check the sw of the extension (dp_table[set-u].ex + u)
+      set.for_each([&](const size_t u){
+        // first, make sure that u is a root in N[set]
+        if(is_root_in_set(u, set)){
+          const DPEntry* const smaller_entry = table.find(set.without(u));
+          if(!smaller_entry) return;
+          DEBUG5(std::cout << "looked up table for " <<set.without(u)<<" (u = "<<nodes.node(u)<<"): "<< smaller_entry->ex<<std::endl);
+          const sw_t sw = smaller_entry->scanwidth_with(N, nodes.node(u));
+          if(sw < best_sw){
+            best_sw = sw;
+            best_smaller_entry = smaller_entry;
+            best_u = u;
+          }
+        }
+      });
+      // copy the dp-table entry for set - u only for the best u and append u along with its direct deg-2 ancestors
+      if(best_smaller_entry) {
+        best_entry = *best_smaller_entry;
+        best_entry.update(N, nodes.node(best_u));
+        for(const Node v: deg2_ancestors[best_u]) best_entry.update(N, v);
+        assert(best_entry.get_scanwidth(N) == best_sw);
+      }
+      return best_sw;
+    }
+
+    template<size_t words>
+    void compute_min_sw_extension_no_bridges(_Extension& ex)
+    {
+      using Mask = FixedBitmask<words>;
+      // this is thee main dynamic programming table - it could grow exponentially large...
+      // the table maps a set X of nodes to any extension with smallest sw for the graph where all nodes but X are contracted onto the root
+      // start off with the empty set of scanwidth 0
+      DPTable<words> dp_table;
+      // rememeber the last node-set (which contains the root since the NetworkConstraintSubsetFactory goes bottom-up)
+      Mask last_set;
+       
+      DEBUG5(std::cout << "======= checking constraint node subsets ========\n");
+      // check all node-subsets constraint by the arcs in N
+      STAT(uint64_t num_subsets = 0;)
+      for(const auto& node_set: NetworkConstraintSubsetFactory<_Network, DenseNodeSet<Mask>>(N, DenseNodeSet<Mask>(nodes))){
+        const Mask& set = node_set.mask();
+        last_set = set;
+        DPEntry& best_entry = *(dp_table.try_emplace(set).first);
+
+        STAT(++num_subsets);
+        DEBUG5(std::cout << "computing best partial extension for node-set "<<set<< "\n");
+
+        compute_entry(set, dp_table, best_entry);
+      }
+      STAT(std::cout << "STAT: " <<N.num_nodes() << " nodes, "<<nodes.size()<<" non-suppressible & "<<num_subsets << " subsets\n";)
+      // the last extension should be the one we are looking for
+      append(ex, dp_table.at(last_set).ex);
+    }
+
+    // add each node that can be added to the given set (that is, all its children are in the set) and, for each resulting set Y,
+    // compute its entry from the entries in 'layer' and put it into 'out' (unless it is pruned)
+    //NOTE: each Y is produced by exactly one of its subsets, namely Y - r for the root r of N[Y] with the largest label such that
+    //      Y - r is in 'layer' (if Y - r was pruned for the largest root r, Y may still have a good extension through another root)
+    template<class Mask, class Layer>
+    void extend_set(const Mask& set,
+                    const Layer& layer,
+                    const std::vector<Mask>& children_masks,
+                    std::vector<std::pair<Mask, DPEntry>>& out,
+                    uint64_t& pruned) const
+    {
+      for(size_t u = 0; u < nodes.size(); ++u) {
+        if(set.test(u) || !children_masks[u].is_subset_of(set)) continue;
+        // u is a root of N[set + u] since its parents cannot be in 'set' (otherwise 'set' would contain u)
+        Mask bigger = set;
+        bigger.set(u);
+        bool largest_root = true;
+        for(size_t v = set.next(u + 1); largest_root && (v < Mask::capacity); v = set.next(v + 1))
+          largest_root = !is_root_in_set(v, bigger) || !layer.find(bigger.without(v));
+        if(largest_root) {
+          auto& [mask, entry] = out.emplace_back(bigger, DPEntry());
+          if(compute_entry(mask, layer, entry) >= upper_bound){
+            out.pop_back();
+            ++pruned;
+          }
+        }
+      }
+    }
+
+    // the DP, going through the node sets by size; the sets of each size are treated in parallel (if we have a pool) and the table
+    // only ever holds the sets of 2 consecutive sizes (the entry of a set only depends on the entries of the sets with one node less)
+    // since the sets are generated from the sets of the previous size, pruned sets are never extended, which makes this the method
+    // of choice if we have an upper bound; return false if all sets of some size are pruned (so there is no extension below the bound)
+    //NOTE: for each set, the candidates are evaluated in the same order as in the sequential DP, so the result is the same
+    template<size_t words>
+    bool compute_min_sw_extension_by_layers(_Extension& ex)
+    {
+      using Mask = FixedBitmask<words>;
+      using Layer = DPTable<words>;
+      std::vector<Mask> children_masks(nodes.size());
+      for(size_t u = 0; u < nodes.size(); ++u)
+        for(const uint32_t v: children[u]) children_masks[u].set(v);
+
+      // start off with the empty set of scanwidth 0
+      Layer layer;
+      layer.try_emplace(Mask());
+      const size_t num_threads = pool ? pool->num_workers() + 1 : 1;
+      STAT(uint64_t num_subsets = 1;)
+      for(size_t size = 0; size < nodes.size(); ++size) {
+        // split the layer into some parts per thread (so the pool can balance the load)
+        const size_t num_parts = std::min(layer.size(), 8 * num_threads);
+        std::vector<std::vector<std::pair<Mask, DPEntry>>> next_parts(num_parts);
+        std::vector<uint64_t> pruned(num_parts, 0);
+        const auto treat_part = [&](const size_t p){
+          const size_t first = p * layer.size() / num_parts;
+          const size_t last = (p + 1) * layer.size() / num_parts;
+          for(size_t i = first; i < last; ++i)
+            extend_set(layer[i].first, layer, children_masks, next_parts[p], pruned[p]);
+        };
+        if(pool){
+          TaskGroup tasks(*pool);
+          for(size_t p = 0; p < num_parts; ++p) tasks.run([&, p]{ treat_part(p); });
+          tasks.wait();
+        } else for(size_t p = 0; p < num_parts; ++p) treat_part(p);
+        for(const uint64_t x: pruned) num_pruned += x;
+
+        size_t next_size = 0;
+        for(const auto& part: next_parts) next_size += part.size();
+        DEBUG3(std::cout << "DP layer "<<size + 1<<": "<<next_size<<" node sets ("<<num_pruned<<" pruned so far)\n");
+        if(next_size == 0) return false;
+        STAT(num_subsets += next_size;)
+        Layer next_layer;
+        next_layer.reserve(next_size);
+        for(auto& part: next_parts)
+          for(auto& [mask, entry]: part)
+            next_layer.try_emplace(mask, std::move(entry));
+        // we don't need the sets of the current size anymore
+        layer = std::move(next_layer);
+      }
+      STAT(std::cout << "STAT: " <<N.num_nodes() << " nodes, "<<nodes.size()<<" non-suppressible & "<<num_subsets << " subsets\n";)
+      // the only set of the last layer is the set of all nodes
+      assert(layer.size() == 1);
+      append(ex, layer[0].second.ex);
+      return true;
+    }
+
+    template<size_t words>
+    bool compute(_Extension& ex)
+    {
+      if(pool || (upper_bound != std::numeric_limits<sw_t>::max()))
+        return compute_min_sw_extension_by_layers<words>(ex);
+      compute_min_sw_extension_no_bridges<words>(ex);
       return true;
     }
 
@@ -75,76 +302,109 @@ namespace PT{
     ScanwidthDP(const _Network& _N, const bool _ignore_deg2 = true): N(_N), ignore_deg2(_ignore_deg2)
     {}
 
-    void compute_min_sw_extension_no_bridges(_Extension& ex)
+    // run the DP with the given number of threads
+    void set_num_threads(const size_t n)
+    {
+      if(n > 1)
+        pool = std::make_shared<WorkStealingPool>(n - 1);
+      else pool.reset();
+    }
+    // run the DP on the given thread pool (which may be shared with other DPs running at the same time)
+    void set_pool(std::shared_ptr<WorkStealingPool> _pool) { pool = std::move(_pool); }
+    // only look for extensions of scanwidth less than the given bound
+    void set_upper_bound(const sw_t bound) { upper_bound = bound; }
+    // the number of node sets that were pruned because their scanwidth reached the upper bound
+    uint64_t get_num_pruned() const { return num_pruned; }
+
+    // append an extension of minimum scanwidth to ex and return true, or return false (and leave ex alone) if there is no extension
+    // of scanwidth less than the upper bound
+    bool compute_min_sw_extension_no_bridges(_Extension& ex)
     {
       // this code asserts that the DPEntry can be move-assigned
       assert(std::is_move_assignable_v<DPEntry>);
       DEBUG4(std::cout << "computing scanwidth of block:\n"<<N<<"\n";);
 
-      // this is thee main dynamic programming table - it could grow exponentially large...
-      // the table maps a set X of nodes to any extension with smallest sw for the graph where all nodes but X are contracted onto the root
-      // start off with the empty set of scanwidth 0
-
       if(N.num_nodes() > 1){
-        // rememeber the best entry for the last node-set (which contains the root since the NetworkConstraintSubsetFactory goes bottom-up
-        typename DPTable::iterator last_iter;
-       
-        DEBUG5(std::cout << "======= checking constraint node subsets ========\n");
-        // check all node-subsets constraint by the arcs in N
-        STAT(uint64_t num_subsets = 0;)
-        for(auto&& nodes: NetworkConstraintSubsetFactory<_Network, HashSet<Node>>(N)){
-          sw_t best_sw = N.num_nodes() + 1;
-          last_iter = append(dp_table, std::move(nodes)).first; // if the node-container is non-const, move the nodes into the map
-          DPEntry& best_entry = last_iter->second;
-
-          STAT(++num_subsets);
-          DEBUG5(
-              std::cout << "computing best partial extension for node-set "<<last_iter->first<< "\n";
-              std::cout << "....::::: best extensions ::::....\n";
-              for(const auto& x: dp_table) std::cout << x.first << ":\t"<<x.second.ex<<"\n";
-              );
-
-          // for each node u in the set, check the sw of the extension (dp_table[nodes-u].ex + u)
-          for(const Node u: nodes){
-            // first, make sure that u is a root in N[nodes]
-            if(is_root_in_set(u, nodes)){
-              // look-up the best extension for nodes - u
-              HashSet<Node> lookup_set(nodes);
-              lookup_set.erase(u);
-              // copy the dp-table entry at lookup_set
-              DPEntry entry = dp_table.at(lookup_set);
-              // add u at the end of it and compute the sw
-              DEBUG5(std::cout << "looked up table for " <<lookup_set<<" (u = "<<u<<"): "<< entry.ex<<std::endl);
-              // append u along with its direct deg-2 ancestors and update the sw-map
-              entry.update(N, u);
-              // also append all suppressible ancestors of u
-              for(Node v: N.parents(u))
-                while(N.is_suppressible(v)){
-                  entry.update(N, v);
-                  v = N.parent(v);
-                }
-              // compute the new scanwidth
-              const sw_t sw = entry.get_scanwidth(N);
-              if(sw < best_sw){
-                best_sw = sw;
-                best_entry = std::move(entry); // move assignment
-              }
-            }
-          }
-        }
-        STAT(uint64_t count_unsupp = 0; for(const auto& u: N) { if(!N.is_suppressible(u)) ++count_unsupp;})
-        STAT(std::cout << "STAT: " <<N.num_nodes() << " nodes, "<<count_unsupp<<" non-suppressible & "<<num_subsets << " subsets\n";)
-        // the last extension should be the one we are looking for
-        append(ex, last_iter->second.ex);
-      } else append(ex, N.root());
+        relabel_nodes();
+        // use the narrowest bitmasks that can hold all nodes
+        const size_t k = nodes.size();
+        if(k <= FixedBitmask<1>::capacity) return compute<1>(ex);
+        else if(k <= FixedBitmask<2>::capacity) return compute<2>(ex);
+        else if(k <= FixedBitmask<4>::capacity) return compute<4>(ex);
+        else if(k <= FixedBitmask<8>::capacity) return compute<8>(ex);
+        else if(k <= FixedBitmask<16>::capacity) return compute<16>(ex);
+        else throw std::invalid_argument("cannot compute the scanwidth of a block with " + std::to_string(k)
+                                         + " non-suppressible nodes exactly (at most " + std::to_string(max_nodes) + " are supported)");
+      } else {
+        append(ex, N.root());
+        return true;
+      }
     }
   };
 
+  // the estimated cost of running the DP on a block: its number of non-suppressible nodes (the DP is exponential in this number)
+  template<class _Network>
+  size_t estimated_dp_cost(const _Network& N)
+  {
+    size_t result = 0;
+    for(const Node u: N.nodes()) result += !N.is_suppressible(u);
+    return result;
+  }
+
+  // compute the extension like compute_min_sw_extension() below, but solve the blocks of N concurrently on a pool of num_threads threads
+  // (the DP of each block is also parallelized on the same pool, so a single large block does not leave the other threads idle)
+  //NOTE: the blocks are started in order of decreasing estimated cost and the extension is assembled in the order of the
+  //      blocks, so the result is the same as that of the sequential version
+  template<bool low_memory_version, class _Network, class _Extension>
+  void compute_min_sw_extension_concurrently(const _Network& N, _Extension& ex, const size_t num_threads)
+  {
+    using Component = typename BiconnectedComponents<_Network>::Component;
+
+    // step 1: materialize the blocks in post-order
+    //NOTE: we use a deque so the components are never moved once constructed
+    std::deque<Component> blocks;
+    for(const Component bcc: BiconnectedComponents<_Network>(N)){
+      DEBUG3(std::cout << "found biconnected component:\n"<< bcc <<"\n");
+      blocks.emplace_back(bcc);
+    }
+    // step 2: solve the non-bridge blocks, largest first
+    std::vector<_Extension> block_ex(blocks.size());
+    std::vector<std::pair<size_t, size_t>> by_cost; // (cost, index)
+    for(size_t i = 0; i < blocks.size(); ++i)
+      if(blocks[i].num_edges() != 1) by_cost.emplace_back(estimated_dp_cost(blocks[i]), i);
+    std::sort(by_cost.begin(), by_cost.end(), [](const auto& x, const auto& y){ return x.first > y.first; });
+    STAT(std::cout << "STAT: solving "<<by_cost.size()<<" blocks concurrently with "<<num_threads<<" threads\n";)
+
+    const auto pool = std::make_shared<WorkStealingPool>(num_threads - 1);
+    {
+      TaskGroup tasks(*pool);
+      for(const auto& [cost, i]: by_cost)
+        tasks.run([&, i = i]{
+            ScanwidthDP<low_memory_version, Component, _Extension> dp(blocks[i]);
+            dp.set_pool(pool);
+            dp.compute_min_sw_extension_no_bridges(block_ex[i]);
+          });
+      tasks.wait();
+    }
+    // step 3: assemble the extension in post-order
+    for(size_t i = 0; i < blocks.size(); ++i){
+      const Component& bcc = blocks[i];
+      if(bcc.num_edges() != 1){
+        append(ex, block_ex[i]);
+        // always remove the root of a component, so the bridge can re-insert it
+        ex.pop_back();
+      } else append(ex, std::front(bcc.edges()).head());
+    }
+    append(ex, N.root());
+  }
+
   template<bool low_memory_version, class _Network, class _Extension>
-  void compute_min_sw_extension(const _Network& N, _Extension& ex)
+  void compute_min_sw_extension(const _Network& N, _Extension& ex, const size_t num_threads = 1)
   {
     using Component = typename BiconnectedComponents<_Network>::Component;
 
+    if(num_threads > 1) return compute_min_sw_extension_concurrently<low_memory_version>(N, ex, num_threads);
+
     for(const Component bcc: BiconnectedComponents<_Network>(N)){
       std::cout << "found biconnected component:\n"<< bcc <<"\n";
       if(bcc.num_edges() != 1){
@@ -0,0 +1,447 @@
+
+#pragma once
+
+#include <queue>
+#include "set_interface.hpp"
+#include "extension.hpp"
+#include "scanwidth.hpp"
+#include "config.hpp"
+
+// a fast heuristic for scanwidth, meant for networks that are too large for the exact DP (and as upper bound for exact methods)
+// (1) we split N at its bridges into pieces: since all nodes below a bridge uv come before u in any extension, the scanwidth of a node
+//     only depends on the order of the nodes of its own piece, so we can solve the pieces independently and glue their extensions
+//     together in post-order of their roots
+// (2) pieces with few non-suppressible nodes are solved exactly by the DP
+// (3) for the other pieces, we build an extension greedily and bottom-up, always appending one of the nodes all of whose children have
+//     already been appended: appending u changes the number of arcs leaving the appended nodes by in-deg(u) - out-deg(u), so we prefer
+//     the nodes that decrease this number most (tree nodes before leaves and reticulations) and, among those, the nodes with the
+//     smallest scanwidth; if the post-order extension of the piece is better, we take that one instead
+// the scanwidth of u in an extension is the number of arcs entering the weak component of u in the graph induced by u and the nodes
+// before it, so it is in-deg(u) - out-deg(u) + the sum of these numbers over the weak components containing u's children (see also
+// ext_tree_sw_map()); we maintain the weak components in a union-find on dense node indices, so appending a node costs (almost) O(its
+// degree) and, apart from the small pieces, all this runs in O(m log n) time on a network with n nodes and m arcs
+//NOTE: the scanwidth of a node that has not been appended changes only if the components of its children are merged by appending
+//      another node; we re-evaluate nodes lazily when they come up in the queue, so we may miss such improvements
+
+namespace PT{
+
+  template<class _Network, class _Extension = Extension>
+  class ScanwidthHeuristic
+  {
+  protected:
+    using Piece = CompatibleRWNetwork<const _Network, void, void>;
+    using Edge = typename _Network::Edge;
+
+    const _Network& N;
+    const size_t exact_piece_size;
+
+    // all nodes of N, relabeled into 0, ..., n-1 in post-order
+    DenseNodeIndex nodes;
+    // the arcs of N without the bridges
+    std::vector<std::vector<uint32_t>> parents;
+    std::vector<std::vector<uint32_t>> children;
+    // for each node, the root of its piece (the pieces are ordered by their roots)
+    std::vector<uint32_t> piece_root;
+    std::vector<uint32_t> piece_roots;
+    // for each piece (indexed by its root), its extension, its width and whether this extension is optimal
+    std::vector<std::vector<uint32_t>> piece_order;
+    std::vector<sw_t> width;
+    std::vector<bool> solved_exactly;
+    // the scanwidth of each node in the last order that we evaluated
+    std::vector<sw_t> node_sw;
+
+    size_t num_exact = 0;
+    size_t num_po = 0;
+    uint64_t num_pruned = 0;
+
+    // union-find on the appended nodes; for each root, the number of arcs entering its component
+    std::vector<uint32_t> comp_parent;
+    std::vector<sw_t> open_arcs;
+    // for each node, the number of its children that have not been appended yet
+    std::vector<size_t> children_left;
+    // the nodes whose children have all been appended, by (in-deg - out-deg, scanwidth at the time they were queued, label)
+    using QueueItem = std::tuple<int, sw_t, uint32_t>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> available;
+
+    void relabel_nodes()
+    {
+      for(const Node u: N.dfs().postorder()) nodes.add(u);
+      const size_t n = nodes.size();
+      parents.resize(n);
+      children.resize(n);
+      for(size_t i = 0; i < n; ++i){
+        const Node u = nodes.node(i);
+        for(const Node v: N.parents(u)) parents[i].push_back(nodes[v]);
+        for(const Node v: N.children(u)) children[i].push_back(nodes[v]);
+      }
+    }
+
+    // remove the bridges of N (see bridges.hpp)
+    //NOTE: the head of a bridge has in-degree 1 (otherwise, both its in-arcs would be on a cycle through the root)
+    void remove_bridges()
+    {
+      const size_t n = nodes.size();
+      const auto bridges = N.get_bridges();
+      for(const auto& uv: bridges){
+        const uint32_t v = nodes[uv.head()];
+        std::vector<uint32_t>& siblings = children[nodes[uv.tail()]];
+        siblings.erase(std::find(siblings.begin(), siblings.end(), v));
+        parents[v].clear();
+      }
+      DEBUG3(std::cout << "found "<<bridges.size()<<" bridges\n");
+
+      // going top-down, each node is in the piece of any of its parents
+      piece_root.resize(n);
+      for(uint32_t i = n; i-- > 0;)
+        piece_root[i] = parents[i].empty() ? i : piece_root[parents[i].front()];
+    }
+
+    bool is_suppressible(const uint32_t u) const { return (parents[u].size() == 1) && (children[u].size() == 1); }
+
+    void reset_components()
+    {
+      const size_t n = nodes.size();
+      comp_parent.resize(n);
+      for(size_t i = 0; i < n; ++i) comp_parent[i] = i;
+      open_arcs.assign(n, 0);
+    }
+
+    uint32_t find(uint32_t u)
+    {
+      while(comp_parent[u] != u){
+        comp_parent[u] = comp_parent[comp_parent[u]];
+        u = comp_parent[u];
+      }
+      return u;
+    }
+
+    // the scanwidth u would have if it was appended now
+    sw_t current_sw(const uint32_t u)
+    {
+      sw_t result = parents[u].size();
+      // each component is counted only once, even if it contains multiple children of u
+      std::vector<uint32_t> roots;
+      roots.reserve(children[u].size());
+      for(const uint32_t v: children[u]){
+        const uint32_t r = find(v);
+        if(std::find(roots.begin(), roots.end(), r) == roots.end()){
+          roots.push_back(r);
+          result += open_arcs[r];
+        }
+      }
+      return result - children[u].size();
+    }
+
+    // append u and merge the components of its children onto it; return the scanwidth of u
+    sw_t append_node(const uint32_t u)
+    {
+      const sw_t sw = current_sw(u);
+      for(const uint32_t v: children[u]) comp_parent[find(v)] = u;
+      open_arcs[u] = sw;
+      return sw;
+    }
+
+    void make_available(const uint32_t u)
+    {
+      available.emplace((int)parents[u].size() - (int)children[u].size(), current_sw(u), u);
+    }
+
+    // append u to the greedy order and queue its parents whose children have now all been appended
+    void append_greedily(const uint32_t u, std::vector<uint32_t>& order, std::vector<sw_t>& sw)
+    {
+      order.push_back(u);
+      sw[u] = append_node(u);
+      for(const uint32_t p: parents[u])
+        if(--children_left[p] == 0){
+          // a suppressible node does not change the scanwidth, so we append it right away (just like the DP does)
+          if(is_suppressible(p))
+            append_greedily(p, order, sw);
+          else make_available(p);
+        }
+    }
+
+    // compute an order of all nodes that is an extension for each piece, and the scanwidth of each node in it
+    void greedy_order(std::vector<uint32_t>& order, std::vector<sw_t>& sw)
+    {
+      reset_components();
+      children_left.resize(nodes.size());
+      for(size_t i = 0; i < nodes.size(); ++i){
+        children_left[i] = children[i].size();
+        if(children[i].empty()) make_available(i);
+      }
+      while(!available.empty()){
+        const auto [delta, queued_sw, u] = available.top();
+        available.pop();
+        // the scanwidth of u may have changed since it was queued, so re-queue it if it got worse
+        const sw_t new_sw = current_sw(u);
+        if(new_sw > queued_sw)
+          available.emplace(delta, new_sw, u);
+        else append_greedily(u, order, sw);
+      }
+      assert(order.size() == nodes.size());
+    }
+
+    // compute the scanwidth of each node in the given order (which has to be an extension for each piece that it touches)
+    //NOTE: arcs never leave a piece, so we only need to reset the components of the nodes in the order
+    void evaluate(const std::vector<uint32_t>& order, std::vector<sw_t>& sw)
+    {
+      for(const uint32_t u: order){
+        comp_parent[u] = u;
+        open_arcs[u] = 0;
+      }
+      for(const uint32_t u: order) sw[u] = append_node(u);
+    }
+
+    // compute the scanwidth of each piece (indexed by its root) in the given order
+    void piece_widths(const std::vector<uint32_t>& order, const std::vector<sw_t>& sw, std::vector<sw_t>& result) const
+    {
+      result.assign(nodes.size(), 0);
+      for(const uint32_t u: order)
+        result[piece_root[u]] = std::max(result[piece_root[u]], sw[u]);
+    }
+
+    // compute the scanwidth of the given order of the nodes of a piece
+    sw_t order_width(const std::vector<uint32_t>& order)
+    {
+      evaluate(order, node_sw);
+      sw_t result = 0;
+      for(const uint32_t u: order) result = std::max(result, node_sw[u]);
+      return result;
+    }
+
+    size_t num_non_suppressible(const uint32_t root) const
+    {
+      size_t result = 0;
+      for(const uint32_t u: piece_order[root]) result += !is_suppressible(u);
+      return result;
+    }
+
+    // run the DP on the piece with the given root, looking only for extensions of width less than 'bound'
+    // return whether there is such an extension and, if so, make it the extension of the piece
+    bool solve_exactly(const uint32_t root, const sw_t bound)
+    {
+      std::vector<uint32_t>& members = piece_order[root];
+      std::vector<Edge> edges;
+      for(const uint32_t u: members)
+        for(const uint32_t v: children[u]) append(edges, nodes.node(u), nodes.node(v));
+      // we don't need the labels for the DP
+      const Piece piece(edges, LabelMapOf<_Network>());
+      _Extension piece_ex;
+      ScanwidthDP<false, Piece, _Extension> dp(piece);
+      dp.set_upper_bound(bound);
+      const bool success = dp.compute_min_sw_extension_no_bridges(piece_ex);
+      num_pruned += dp.get_num_pruned();
+      if(success){
+        members.clear();
+        for(const Node u: piece_ex) members.push_back(nodes[u]);
+        assert(members.back() == root);
+        width[root] = order_width(members);
+      }
+      return success;
+    }
+
+    // split N into pieces and compute an extension for each of them
+    void solve_pieces()
+    {
+      relabel_nodes();
+      remove_bridges();
+      const size_t n = nodes.size();
+      node_sw.resize(n);
+
+      // candidate 1: the greedy order
+      std::vector<uint32_t> order;
+      greedy_order(order, node_sw);
+      piece_widths(order, node_sw, width);
+
+      // candidate 2: the post-order
+      std::vector<uint32_t> po_order(n);
+      std::vector<sw_t> po_width;
+      for(uint32_t i = 0; i < n; ++i) po_order[i] = i;
+      evaluate(po_order, node_sw);
+      piece_widths(po_order, node_sw, po_width);
+
+      // sort the nodes of each candidate into their pieces
+      piece_order.assign(n, {});
+      std::vector<std::vector<uint32_t>> piece_po_order(n);
+      for(const uint32_t u: order) piece_order[piece_root[u]].push_back(u);
+      for(const uint32_t u: po_order) piece_po_order[piece_root[u]].push_back(u);
+
+      solved_exactly.assign(n, false);
+      for(uint32_t r = 0; r < n; ++r){
+        if(piece_order[r].empty()) continue;
+        piece_roots.push_back(r);
+        if(po_width[r] < width[r]){
+          piece_order[r] = std::move(piece_po_order[r]);
+          width[r] = po_width[r];
+          ++num_po;
+        }
+        // the DP only has to look for extensions that are better than the one we already have
+        if((piece_order[r].size() > 1) && (num_non_suppressible(r) <= exact_piece_size)){
+          solve_exactly(r, width[r]);
+          solved_exactly[r] = true;
+          ++num_exact;
+        }
+        DEBUG4(std::cout << "piece of "<<nodes.node(r)<<" ("<<piece_order[r].size()<<" nodes) has width "<<width[r]<<"\n");
+      }
+    }
+
+    // the scanwidth of the extension that we get by gluing together the extensions of the pieces
+    sw_t total_width() const
+    {
+      // each bridge has scanwidth 1
+      sw_t result = (piece_roots.size() > 1);
+      for(const uint32_t r: piece_roots) result = std::max(result, width[r]);
+      return result;
+    }
+
+    // append the extensions of the pieces to ex (in post-order of their roots) and return the scanwidth of the result
+    sw_t assemble(_Extension& ex) const
+    {
+      for(const uint32_t r: piece_roots)
+        for(const uint32_t u: piece_order[r]) append(ex, nodes.node(u));
+      return total_width();
+    }
+
+  public:
+
+    ScanwidthHeuristic(const _Network& _N, const size_t _exact_piece_size = config::heuristic_exact_piece_size):
+      N(_N), exact_piece_size(_exact_piece_size)
+    {}
+
+    // the number of node sets that the DP pruned (because they were not better than the extension we already had)
+    uint64_t get_num_pruned() const { return num_pruned; }
+
+    // compute an extension of N, append it to ex and return its scanwidth
+    sw_t compute_extension(_Extension& ex)
+    {
+      if(N.empty()) return 0;
+      solve_pieces();
+      STAT(std::cout << "STAT: heuristic: "<<piece_roots.size()<<" pieces ("<<num_exact<<" solved exactly, post-order was better for "<<num_po<<")\n";)
+      return assemble(ex);
+    }
+  };
+
+  // compute an extension of N of small (but not necessarily minimum) scanwidth, append it to ex and return its scanwidth
+  template<class _Network, class _Extension>
+  sw_t compute_heuristic_sw_extension(const _Network& N, _Extension& ex, const size_t exact_piece_size = config::heuristic_exact_piece_size)
+  {
+    return ScanwidthHeuristic<_Network, _Extension>(N, exact_piece_size).compute_extension(ex);
+  }
+
+
+  // an exact algorithm for scanwidth by branch-and-bound: we start with the extensions of the pieces found by the heuristic (the
+  // largest of their widths is an upper bound on the scanwidth of N) and cheap lower bounds on the scanwidth of each piece:
+  // (1) the in-degree of each node (the in-arcs of u enter the weak component of u when it is appended)
+  // (2) for the root r and each weak component C of the piece minus r, the number of arcs from r to C (when the last node of C is
+  //     appended, C is a weak component and its only entering arcs come from r)
+  // then, we go through the pieces by decreasing width and run the DP on each piece that is wider than the lower bound, pruning all
+  // node sets whose partial extension is at least as wide as the extension of the piece that we already have; the width we get is
+  // optimal for the piece, so it is a lower bound for N
+  // we stop as soon as the lower bound meets the upper bound (then, the extensions of the remaining pieces are good enough)
+  template<class _Network, class _Extension = Extension>
+  class ScanwidthBranchAndBound: public ScanwidthHeuristic<_Network, _Extension>
+  {
+    using Parent = ScanwidthHeuristic<_Network, _Extension>;
+    using DP = ScanwidthDP<false, typename Parent::Piece, _Extension>;
+    using Parent::N;
+    using Parent::nodes;
+    using Parent::parents;
+    using Parent::children;
+    using Parent::piece_root;
+    using Parent::piece_roots;
+    using Parent::comp_parent;
+    using Parent::width;
+    using Parent::solved_exactly;
+    using Parent::num_pruned;
+    using Parent::find;
+
+    sw_t lower_bound = 0;
+    sw_t upper_bound = 0;
+
+    // compute the lower bounds (1) and (2) for each piece (indexed by its root)
+    void piece_lower_bounds(std::vector<sw_t>& lower)
+    {
+      const size_t n = nodes.size();
+      lower.assign(n, 0);
+      for(uint32_t u = 0; u < n; ++u)
+        lower[piece_root[u]] = std::max<sw_t>(lower[piece_root[u]], parents[u].size());
+
+      // compute the weak components of the pieces without their roots
+      Parent::reset_components();
+      for(uint32_t u = 0; u < n; ++u)
+        if(!parents[u].empty())
+          for(const uint32_t v: children[u]) comp_parent[find(v)] = find(u);
+      std::vector<sw_t> arcs_from_root(n, 0);
+      for(const uint32_t r: piece_roots){
+        for(const uint32_t v: children[r]) lower[r] = std::max(lower[r], ++arcs_from_root[find(v)]);
+        for(const uint32_t v: children[r]) arcs_from_root[find(v)] = 0;
+      }
+    }
+
+  public:
+    using Parent::Parent;
+    using Parent::get_num_pruned;
+
+    // after compute_min_extension(), these are the bounds on the scanwidth of N (they are equal unless a piece was too large for the DP)
+    sw_t get_lower_bound() const { return lower_bound; }
+    sw_t get_upper_bound() const { return upper_bound; }
+
+    // compute an extension of N of minimum scanwidth, append it to ex and return its scanwidth
+    sw_t compute_min_extension(_Extension& ex)
+    {
+      if(N.empty()) return 0;
+      Parent::solve_pieces();
+
+      std::vector<sw_t> lower;
+      piece_lower_bounds(lower);
+      // each bridge has scanwidth 1
+      lower_bound = (piece_roots.size() > 1);
+      for(const uint32_t r: piece_roots){
+        if(solved_exactly[r]) lower[r] = width[r];
+        lower_bound = std::max(lower_bound, lower[r]);
+      }
+      upper_bound = Parent::total_width();
+      STAT(std::cout << "STAT: branch and bound: "<<piece_roots.size()<<" pieces, "<<lower_bound<<" <= scanwidth <= "<<upper_bound<<"\n";)
+
+      std::vector<uint32_t> by_width = piece_roots;
+      std::stable_sort(by_width.begin(), by_width.end(), [&](const uint32_t x, const uint32_t y){ return width[x] > width[y]; });
+      // the widest pieces that we have already treated
+      sw_t treated_width = 0;
+      for(size_t i = 0; (i < by_width.size()) && (lower_bound < upper_bound); ++i){
+        const uint32_t r = by_width[i];
+        // all remaining pieces are at most as wide as the lower bound
+        if(width[r] <= lower_bound) break;
+        if(lower[r] < width[r]){
+          const size_t k = Parent::num_non_suppressible(r);
+          if(k > DP::max_nodes){
+            DEBUG3(std::cout << "piece of "<<nodes.node(r)<<" has "<<k<<" non-suppressible nodes, which is too many for the DP\n");
+            treated_width = std::max(treated_width, width[r]);
+            continue;
+          }
+          const sw_t old_width = width[r];
+          Parent::solve_exactly(r, old_width);
+          DEBUG3(std::cout << "piece of "<<nodes.node(r)<<" ("<<k<<" non-suppressible nodes): width "<<old_width<<" -> "<<width[r]
+                    <<" ("<<num_pruned<<" node sets pruned so far)\n");
+        }
+        // now, the width of the piece is optimal
+        lower_bound = std::max(lower_bound, width[r]);
+        treated_width = std::max(treated_width, width[r]);
+        // the pieces after i still have their widths from the heuristic and these are sorted decreasingly in by_width,
+        // so the widest of them is by_width[i+1] and the extension we would assemble now has width max(treated_width, width[by_width[i+1]])
+        upper_bound = std::max<sw_t>(treated_width, (i + 1 < by_width.size()) ? width[by_width[i + 1]] : 0);
+        upper_bound = std::max(upper_bound, lower_bound);
+      }
+      STAT(std::cout << "STAT: branch and bound: "<<lower_bound<<" <= scanwidth <= "<<upper_bound<<" ("<<num_pruned<<" node sets pruned)\n";)
+      return Parent::assemble(ex);
+    }
+  };
+
+  // compute an extension of N of minimum scanwidth by branch-and-bound, append it to ex and return its scanwidth
+  template<class _Network, class _Extension>
+  sw_t compute_min_sw_extension_bnb(const _Network& N, _Extension& ex)
+  {
+    return ScanwidthBranchAndBound<_Network, _Extension>(N).compute_min_extension(ex);
+  }
+
+}// namespace
+
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+#include "utils.hpp"
+
+/*
+ * a budget limiting the resources that a (branching) search may use: a wall-clock deadline, a maximum number of branch nodes
+ * (nodes of the search tree at which the search branches), and a cap on the resident memory of the process
+ * the search checks the budget regularly and gives up as soon as it has run out; the budget can also be cancelled from another thread
+ * the budget also collects some statistics of the search (in total and for each depth of the search tree), which can be inspected
+ * while and after the search runs
+ * a budget is shared among all branches of a search (including those running in parallel), so everything here is thread-safe
+ */
+
+namespace PT{
+
+  // the answer of a search with a budget
+  enum class Verdict { not_displayed = 0, displayed = 1, unknown = 2 };
+
+  inline std::ostream& operator<<(std::ostream& os, const Verdict v)
+  {
+    switch(v){
+      case Verdict::not_displayed: return os << "not displayed";
+      case Verdict::displayed: return os << "displayed";
+      default: return os << "unknown";
+    }
+  }
+
+  // the reason why a budget ran out
+  enum class BudgetLimit { none = 0, cancelled, deadline, branch_nodes, memory };
+
+  inline std::ostream& operator<<(std::ostream& os, const BudgetLimit l)
+  {
+    switch(l){
+      case BudgetLimit::none: return os << "none";
+      case BudgetLimit::cancelled: return os << "cancelled";
+      case BudgetLimit::deadline: return os << "deadline reached";
+      case BudgetLimit::branch_nodes: return os << "branch-node limit reached";
+      default: return os << "memory limit reached";
+    }
+  }
+
+  // statistics of the nodes of the search tree at a given depth
+  struct SearchLevelStats
+  {
+    size_t nodes = 0;         // nodes of the search tree that have been explored (reduced) at this depth
+    size_t branch_nodes = 0;  // those at which we branched
+    size_t branches = 0;      // branches that have been started from them
+    double seconds = 0;       // time spent in these nodes (reducing and choosing the branching, but not in their branches)
+
+    double branching_factor() const { return branch_nodes ? double(branches) / branch_nodes : 0.0; }
+
+    friend std::ostream& operator<<(std::ostream& os, const SearchLevelStats& l)
+    {
+      return os << l.nodes << " nodes, " << l.branch_nodes << " branch nodes, branching factor " << l.branching_factor() << ", "
+                << l.seconds * 1000 << "ms";
+    }
+  };
+
+  struct SearchStats
+  {
+    size_t nodes = 0;             // nodes of the search tree that have been explored
+    size_t branch_nodes = 0;      // nodes of the search tree at which we branched
+    size_t branches = 0;          // branches that have been started
+    size_t reduction_rounds = 0;  // rounds of the reduction-rule loop
+    size_t max_depth = 0;         // maximum number of branchings above any branch
+    double seconds = 0;           // time since the budget was created
+    std::vector<SearchLevelStats> levels; // the statistics for each depth
+
+    double branching_factor() const { return branch_nodes ? double(branches) / branch_nodes : 0.0; }
+
+    friend std::ostream& operator<<(std::ostream& os, const SearchStats& s)
+    {
+      return os << s.nodes << " nodes, " << s.branch_nodes << " branch nodes, " << s.branches << " branches (branching factor "
+                << s.branching_factor() << "), " << s.reduction_rounds << " reduction rounds, max depth " << s.max_depth << ", "
+                << s.seconds << "s";
+    }
+  };
+
+  // return the resident memory of this process in bytes (or 0 if we cannot find out)
+  inline size_t resident_memory()
+  {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages, resident_pages;
+    if(statm >> total_pages >> resident_pages)
+      return resident_pages * sysconf(_SC_PAGESIZE);
+    else return 0;
+  }
+
+  class SearchBudget
+  {
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point deadline = Clock::time_point::max();
+    size_t max_branch_nodes = 0; // 0 = unlimited
+    size_t max_memory = 0;       // in bytes, 0 = unlimited
+
+    // reading the memory consumption is expensive, so we only do it every so often
+    static constexpr size_t memory_check_interval = 64;
+    mutable std::atomic<size_t> checks_until_memory_check = 0;
+
+    // once the budget ran out, we remember why
+    mutable std::atomic<BudgetLimit> limit = BudgetLimit::none;
+
+    std::atomic<size_t> nodes = 0;
+    std::atomic<size_t> branch_nodes = 0;
+    std::atomic<size_t> branches = 0;
+    std::atomic<size_t> reduction_rounds = 0;
+    std::atomic<size_t> max_depth = 0;
+    std::vector<SearchLevelStats> levels;
+    mutable std::mutex levels_lock;
+
+    SearchLevelStats& level(const size_t depth)
+    {
+      if(levels.size() <= depth) levels.resize(depth + 1);
+      return levels[depth];
+    }
+
+    bool run_out(const BudgetLimit why) const
+    {
+      BudgetLimit expected = BudgetLimit::none;
+      limit.compare_exchange_strong(expected, why);
+      return true;
+    }
+
+  public:
+
+    template<class Duration>
+    void set_deadline(const Duration& time_limit) { deadline = start + std::chrono::duration_cast<Clock::duration>(time_limit); }
+    void set_max_branch_nodes(const size_t n) { max_branch_nodes = n; }
+    void set_max_memory(const size_t bytes) { max_memory = bytes; }
+
+    // stop the search as soon as possible (this can be called from any thread)
+    void cancel() { run_out(BudgetLimit::cancelled); }
+
+    // return whether the budget has run out (this is what the search calls regularly)
+    bool exhausted() const
+    {
+      if(limit.load(std::memory_order_relaxed) != BudgetLimit::none) return true;
+      if(Clock::now() > deadline) return run_out(BudgetLimit::deadline);
+      if(max_memory && (checks_until_memory_check.fetch_sub(1, std::memory_order_relaxed) == 0)) {
+        checks_until_memory_check = memory_check_interval;
+        if(resident_memory() > max_memory) return run_out(BudgetLimit::memory);
+      }
+      return false;
+    }
+
+    // return whether the budget has run out during one of the checks above, and why
+    //NOTE: contrary to exhausted(), this does not check the budget again, so a search that has already finished is not affected
+    bool ran_out() const { return limit != BudgetLimit::none; }
+    BudgetLimit why() const { return limit; }
+
+    // register a new branch node (return false if this would exceed the maximum number of branch nodes)
+    bool count_branch_node()
+    {
+      const size_t n = ++branch_nodes;
+      if(max_branch_nodes && (n > max_branch_nodes)) {
+        --branch_nodes; // we didn't branch after all
+        run_out(BudgetLimit::branch_nodes);
+        return false;
+      } else return true;
+    }
+
+    // register a new branch at the given depth (> 0)
+    void count_branch(const size_t depth)
+    {
+      ++branches;
+      size_t known_depth = max_depth;
+      while((known_depth < depth) && !max_depth.compare_exchange_weak(known_depth, depth));
+      const std::lock_guard<std::mutex> guard(levels_lock);
+      ++level(depth - 1).branches;
+    }
+
+    // register that a node of the search tree at the given depth has been explored, taking the given time (not counting its
+    // branches), and whether we branched at it
+    void count_node(const size_t depth, const double seconds, const bool branched)
+    {
+      ++nodes;
+      const std::lock_guard<std::mutex> guard(levels_lock);
+      SearchLevelStats& l = level(depth);
+      ++l.nodes;
+      l.branch_nodes += branched;
+      l.seconds += seconds;
+    }
+
+    void count_reduction_round() { reduction_rounds.fetch_add(1, std::memory_order_relaxed); }
+
+    SearchStats stats() const
+    {
+      const std::lock_guard<std::mutex> guard(levels_lock);
+      return {nodes, branch_nodes, branches, reduction_rounds, max_depth, std::chrono::duration<double>(Clock::now() - start).count(), levels};
+    }
+  };
+
+}
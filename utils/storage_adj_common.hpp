@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <optional>
 #include "predicates.hpp"
 #include "filter.hpp"
 #include "edge.hpp"
@@ -8,6 +9,7 @@
 #include "storage.hpp"
 #include "set_interface.hpp"
 #include "singleton.hpp"
+#include "trail.hpp"
 
 #warning TODO: implement move constructors for edge storages and adjacency storages!!!
 #warning TODO: instead of having 2 containers (1 for succ, 1 for pred), store only 1 map (node to preds, succ). Then, create a 'DegreeIterator' and create a 'Reticulation'-predicate and then create a reticulations()-function
@@ -206,6 +208,7 @@ namespace PT{
   class __AddNodeData: public _EdgeStorage
   {
     using Parent = _EdgeStorage;
+    template<class, class> friend class TrailLog;
     _NodeDataMap node_data;
   public:
     using NodeDataMap = _NodeDataMap;
@@ -214,21 +217,69 @@ namespace PT{
     static constexpr bool has_node_data = true;
 
   protected:
+    // ================== undo-trail =====================
+    // the node data of a node before the first non-const access to it since the current checkpoint (nullopt if it had no data)
+    using NodeDataSnapshot = std::pair<Node, std::optional<NodeData>>;
+    using NodeDataLog = TrailLog<__AddNodeData, NodeDataSnapshot>;
+    TrailLogHolder<NodeDataLog> node_data_log;
+    // the ID of the checkpoint at which each node's data was last saved (we only need to save it once per checkpoint)
+    typename _EdgeStorage::template NodeMap<size_t> node_data_saved_at;
+
+    void save_node_data(const Node u)
+    {
+      if(node_data_log && node_data_log->recording()){
+        size_t& saved_at = node_data_saved_at[u];
+        const size_t id = node_data_log->get_trail().checkpoint_id();
+        if(saved_at != id){
+          saved_at = id;
+          const auto u_data = node_data.find(u);
+          if(u_data != node_data.end())
+            node_data_log->save(u, u_data->second);
+          else
+            node_data_log->save(u, std::nullopt);
+        }
+      }
+    }
+
+    void restore_from_trail(NodeDataSnapshot&& snap)
+    {
+      if(snap.second) {
+        //NOTE: try_emplace() does not move from its arguments if the node already has data
+        const auto [iter, success] = node_data.try_emplace(snap.first, std::move(*snap.second));
+        if(!success) iter->second = std::move(*snap.second);
+      } else
+        node_data.erase(snap.first);
+    }
+
     template<class... Args>
-    NodeData& emplace_node_data(const Node u, Args&&... args) { return node_data.try_emplace(u, std::forward<Args>(args)...).first->second; }
+    NodeData& emplace_node_data(const Node u, Args&&... args)
+    {
+      save_node_data(u);
+      return node_data.try_emplace(u, std::forward<Args>(args)...).first->second;
+    }
 
-    void erase_node_data(const Node x) override { node_data.erase(x); }
+    void erase_node_data(const Node x) override { save_node_data(x); node_data.erase(x); }
     
   public:
+    // record all future modifications (of edges and node data) on the given trail (or stop recording if nullptr is given)
+    //NOTE: only available if the underlying edge storage supports trails
+    template<class __EdgeStorage = _EdgeStorage, class = decltype(std::declval<__EdgeStorage&>().set_trail(nullptr))>
+    void set_trail(UndoTrail* trail)
+    {
+      Parent::set_trail(trail);
+      node_data_log.bind(*this, trail);
+      node_data_saved_at.clear();
+    }
+
     // on const EdgeStorages, use node_data.at(), which will throw an exception if u does not yet have node data
     const NodeData& get_node_data(const Node u) const { return node_data.at(u); }
     const NodeData& operator[](const Node u) const { return get_node_data(u); }
     
     // on non-const EdgeStorages, operator[] can emplace NodeData...
     template<class = std::enable_if_t<std::is_default_constructible_v<_NodeData>>, class... Args>
-    NodeData& operator[](const Node u) { return node_data[u]; }
+    NodeData& operator[](const Node u) { save_node_data(u); return node_data[u]; }
     // ... but get_node_data() will throw an out_of_range exception
-    NodeData& get_node_data(const Node u) { return node_data.at(u); }
+    NodeData& get_node_data(const Node u) { save_node_data(u); return node_data.at(u); }
     const NodeDataMap& get_node_data() const { return node_data; }
 
     // modification
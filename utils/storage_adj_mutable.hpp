@@ -4,6 +4,8 @@
 
 #include "predicates.hpp"
 #include "storage_adj_common.hpp"
+#include "trail.hpp"
+#include "worklist.hpp"
 
 
 /*
@@ -47,6 +49,7 @@ namespace PT{
   class MutableAdjacencyStorage: public RootedAdjacencyStorage<_EdgeData, _SuccessorMap, _PredecessorMap>
   {
     using Parent = RootedAdjacencyStorage<_EdgeData, _SuccessorMap, _PredecessorMap>;
+    template<class, class> friend class TrailLog;
   protected:
     using Parent::_successors;
     using Parent::_predecessors;
@@ -54,6 +57,54 @@ namespace PT{
     using Parent::_size;
 
     Node next_node_index = 0;
+
+    // ================== undo-trail =====================
+    // the state of a node's adjacencies (and the global counters) before a modification
+    struct AdjacencySnapshot
+    {
+      Node node;
+      bool existed;
+      typename Parent::SuccContainer succ;
+      typename Parent::PredContainer pred;
+      Node root;
+      size_t size;
+      Node next_index;
+    };
+    using AdjacencyLog = TrailLog<MutableAdjacencyStorage, AdjacencySnapshot>;
+    TrailLogHolder<AdjacencyLog> adjacency_log;
+
+    // someone who wants to know which nodes we modify (if any)
+    ListenerHolder listener;
+
+    // tell our listener that we're about to modify x and, if we're recording on a trail, save the adjacencies of x before modifying them
+    void save_adjacencies(const Node x)
+    {
+      if(listener) listener->modifying(x);
+      if(adjacency_log && adjacency_log->recording()){
+        const auto x_succ = _successors.find(x);
+        if(x_succ != _successors.end())
+          adjacency_log->save(AdjacencySnapshot{x, true, x_succ->second, _predecessors.at(x), _root, _size, next_node_index});
+        else
+          adjacency_log->save(AdjacencySnapshot{x, false, {}, {}, _root, _size, next_node_index});
+      }
+    }
+    template<class Container>
+    void save_adjacencies_of_all(const Container& c) { for(const Node x: c) save_adjacencies(x); }
+
+    void restore_from_trail(AdjacencySnapshot&& snap)
+    {
+      if(snap.existed){
+        _successors[snap.node] = std::move(snap.succ);
+        _predecessors[snap.node] = std::move(snap.pred);
+      } else {
+        _successors.erase(snap.node);
+        _predecessors.erase(snap.node);
+      }
+      _root = snap.root;
+      _size = snap.size;
+      next_node_index = snap.next_index;
+    }
+
   public:
     using MutabilityTag = mutable_tag;
     using Parent::Parent;
@@ -79,8 +130,17 @@ namespace PT{
 #warning TODO: re-design such that it is always in a consistent state (single root, no cycles) --> disallow arbitrary deletion
 
 
+    // record all future modifications on the given trail (or stop recording if nullptr is given)
+    //NOTE: copies of this storage will not record on the trail
+    void set_trail(UndoTrail* trail) { adjacency_log.bind(*this, trail); }
+
+    // tell the given listener about all future modifications (or stop telling anyone if nullptr is given)
+    //NOTE: copies of this storage will not tell the listener
+    void set_listener(ModificationListener* _listener) { listener.bind(_listener); }
+
     Node add_node()
     {
+      save_adjacencies(next_node_index);
       assert(!test(_successors, next_node_index) && !test(_predecessors, next_node_index));
       _successors.try_emplace(next_node_index);
       _predecessors.try_emplace(next_node_index);
@@ -93,6 +153,7 @@ namespace PT{
     Node add_node_idx(const Node index)
     {
       if(!test(_successors, index)){
+        save_adjacencies(index);
         _successors.try_emplace(index);
         _predecessors.try_emplace(index);
         if(_root == NoNode) _root = index;
@@ -105,6 +166,7 @@ namespace PT{
     Node add_child(const Node u, const Node index = NoNode)
     {
       const Node v = index == NoNode ? add_node() : add_node_idx(index);
+      save_adjacencies(u);
       append(_predecessors, v, u);
       append(_successors, u, v);
       return v;
@@ -119,6 +181,8 @@ namespace PT{
     bool add_edge(const Node u, _Adjacency&& v)
     {
       const Node v_idx = static_cast<Node>(v);
+      save_adjacencies(u);
+      save_adjacencies(v_idx);
       const auto [it, success] = append(_successors[u], std::move(v));
       if(success){
         if(append(_predecessors[v_idx], get_reverse_adjacency(u, *it)).second){
@@ -136,6 +200,9 @@ namespace PT{
     bool replace_parent(const Node z, const Node old_parent, const Node new_parent)
     {
       if(old_parent == new_parent) return true;
+      save_adjacencies(z);
+      save_adjacencies(old_parent);
+      save_adjacencies(new_parent);
 
       auto& y_children = _successors.at(old_parent);
       const auto z_iter = y_children.find(z);
@@ -168,6 +235,9 @@ namespace PT{
     bool replace_child(const Node y, const Node old_child, const Node new_child)
     {
       if(old_child == new_child) return true;
+      save_adjacencies(y);
+      save_adjacencies(old_child);
+      save_adjacencies(new_child);
 
       auto& y_children = _successors.at(y);
       const auto z_iter = y_children.find(old_child);
@@ -210,6 +280,8 @@ namespace PT{
     void contract_upwards(const Node v, const Node u)
     {
       assert(auto_find(_predecessors.at(v), u));
+      save_adjacencies(u);
+      save_adjacencies(v);
       
       auto& v_succ = _successors.at(v);
       while(!v_succ.empty()) replace_parent(front(v_succ), v, u);
@@ -226,6 +298,8 @@ namespace PT{
     void contract_downwards(const Node u, const Node v)
     {
       assert(auto_find(_predecessors.at(v), u));
+      save_adjacencies(u);
+      save_adjacencies(v);
 
       std::cout << "contracting "<<u<<" onto its child "<<v<<"\n";
       while(out_degree(u)) replace_parent(any_child(u), u, v);
@@ -305,6 +379,8 @@ namespace PT{
     bool add_edge_secure(const Edge& uv) { return add_edge(uv.tail(), uv.get_adjacency()); }
     bool add_edge_secure(const Node u, Adjacency&& v)
     {
+      save_adjacencies(u);
+      save_adjacencies(v);
       auto emp_succ = append(_successors, u);
       if(emp_succ.second){
         // oh, u did not exist before, so we added a new root
@@ -338,6 +414,8 @@ namespace PT{
       if(v_in != _predecessors.end()){
         // the data structure better be consistent
         assert(test(v_in->second, u));
+        save_adjacencies(u);
+        save_adjacencies(v);
         // remove uv from both containers
         _successors.at(u).erase(v);
         v_in->second.erase(u);
@@ -352,6 +430,11 @@ namespace PT{
       if((v == _root) && (out_degree(_root) > 1)) throw(std::logic_error("cannot remove the root unless it has out-degree one"));
       const auto v_pre = _predecessors.find(v);
       if(v_pre != _predecessors.end()){
+        if(adjacency_log || listener) {
+          save_adjacencies(v);
+          save_adjacencies_of_all(v_pre->second);
+          save_adjacencies_of_all(_successors.at(v));
+        }
         for(const Node u: v_pre->second)
           _successors.at(u).erase(v);
         _size -= v_pre->second.size();
@@ -42,7 +42,7 @@ namespace PT{
       }
     }
 
-    inline bool current_state(const Node u) const { return test(current, u); }
+    inline bool current_state(const Node u) const { return std::test(current, u); }
     inline void first_subset() {
       size_t time = 0;
       init_DFS(N.root(), time);
@@ -87,7 +87,7 @@ namespace PT{
     void branch_to_one(const Node u)
     {
       DEBUG4(std::cout << "switching branch of "<< u << " from "<<current_state(u)<<" ["<<test(available, po_number.at(u))<<"] to 1"<<std::endl);
-      append(current, u);
+      std::append(current, u);
       propagate_nonzero_up(u);
       DEBUG5(std::cout << "b1("<<u<<") -- current: "<<current<<" - available: "<<available<<" - branched: "<<branched<<std::endl);
     }
@@ -122,8 +122,12 @@ namespace PT{
 
   public:
 
-    NetworkConstraintSubsetIterator(const _Network& _N, const bool construct_end_iterator = false, const bool _ignore_deg2_nodes = true):
-      N(_N), ignore_deg2_nodes(_ignore_deg2_nodes)
+    //NOTE: the output sets are built starting from the given empty set (use this if _Container cannot be default constructed sensibly)
+    NetworkConstraintSubsetIterator(const _Network& _N,
+                                    const bool construct_end_iterator = false,
+                                    const bool _ignore_deg2_nodes = true,
+                                    _Container _empty_set = _Container()):
+      N(_N), ignore_deg2_nodes(_ignore_deg2_nodes), current(std::move(_empty_set))
     {
       if(!construct_end_iterator)
         first_subset();
@@ -158,11 +162,14 @@ namespace PT{
     using const_iterator = iterator;
 
     const _Network& N;
+    const _Container empty_set;
 
-    NetworkConstraintSubsetFactory(const _Network& _N): N(_N) {}
+    NetworkConstraintSubsetFactory(const _Network& _N, _Container _empty_set = _Container()):
+      N(_N), empty_set(std::move(_empty_set))
+    {}
 
-    iterator begin() const { return iterator(N); }
-    iterator end() const { return iterator(N, true); }
+    iterator begin() const { return iterator(N, false, true, empty_set); }
+    iterator end() const { return iterator(N, true, true, empty_set); }
   };
  
 }// namespace
@@ -1,73 +1,314 @@
-
 #pragma once
 
-#include<stack>
+#include "utils.hpp"
+#include "net_containment.hpp"
+
+/*
+ * a pre-pass for tree containment that shrinks the network N and the tree T before the containment engine starts
+ * (1) leaves of N whose labels do not occur in T are removed (and N is cleaned up)
+ * (2) if there is no reticulation below a node r of N, then r is stable on all leaves below it and the subtree S below r appears as
+ *     the same pendant subtree in each tree displayed by N; thus, if N displays T, then T contains S as a pendant subtree and we can
+ *     replace S by a single leaf in both N and T (and if T does not contain S as a pendant subtree, then N does not display T)
+ *     we do this for the highest such nodes r, found in a single bottom-up pass over N; the corresponding subtrees of T are found
+ *     in a single bottom-up pass over T and compared to those of N by their clusters, so the whole pre-pass runs in linear time
+ *NOTE: the containment engine reduces such subtrees as well (cherry by cherry), but doing it beforehand is cheaper and tells us how
+ *      much of the instance they make up; other components that are stable on a leaf are left to the engine (see VisibleComponentRule)
+ */
 
 namespace PT {
 
-  template<class _Network>
+  struct TC_PreprocessStats
+  {
+    size_t host_nodes_removed = 0;
+    size_t host_edges_removed = 0;
+    size_t guest_nodes_removed = 0;
+    size_t guest_edges_removed = 0;
+    size_t components_reduced = 0;
+
+    friend std::ostream& operator<<(std::ostream& os, const TC_PreprocessStats& s)
+    {
+      return os << "removed " << s.host_nodes_removed << " nodes and " << s.host_edges_removed << " edges from the network and "
+                << s.guest_nodes_removed << " nodes and " << s.guest_edges_removed << " edges from the tree, "
+                << s.components_reduced << " stable components reduced";
+    }
+  };
+
+  template<class _Network, class _Tree>
   class TC_Preprocessor
   {
     using Network = _Network;
+    using Tree = _Tree;
+    using LabelType = std::remove_cvref_t<typename Network::LabelType>;
 
     Network& N;
-    LSATree& lsa;
-    ComponentRootInfo& cr_info;
+    Tree& T;
+
+    // the leaf of T with each label
+    HashMap<LabelType, Node> T_leaves;
+    size_t num_T_leaves = 0;
+    // if a leaf of T does not appear in N, then N cannot display T
+    bool failed = false;
 
-    // map each component root r to any leaf that r is stable on
-    std::unordered_map<Node, Node> leaf_stability;
+    TC_PreprocessStats stats;
+    NetContainmentStats reducer_stats;
 
+    template<class Phylogeny>
+    void clean_up(Phylogeny& P, const NodeVec& nodes)
+    {
+      DisplayedTreesReducer<Phylogeny> reducer(P, reducer_stats);
+      reducer.add_all(nodes);
+      reducer.apply();
+    }
 
-    // compute the leaf_stability mapping by scanning the LSA tree bottom-up
-    void compute_leaf_stability()
+    // remove the given leaves from P and clean up their parents
+    template<class Phylogeny>
+    void remove_leaves(Phylogeny& P, const NodeVec& leaves)
     {
-      std::queue<Node> next_lsa;
-      // add dominators of all leaves
-      for(const Node l: N.get_leaves()){
-        const Node l_dom = lsa[l];
-        leaf_stability[l_dom] = l;
-        next_lsa.push(l_dom);
+      NodeVec parents;
+      for(const Node x: leaves) {
+        for(const Node p: P.parents(x)) parents.push_back(p);
+        P.remove_node(x, true);
       }
-      while(!next_lsa.empty()){
-        const Node u = next_lsa.front();
-        const Node u_dom = lsa[u];
-        next_lsa.pop();
-
-        // if u_dom is not already stable on a leaf, register his stability on the leaf that u is stable on
-        const auto emplace_result = leaf_stability.emplace(u_dom, leaf_stability.at(u));
-        if(emplace_result.second){
-          emplace_result.first->second = leaf_stability[u];
-          next_lsa.push(u_dom);
+      clean_up(P, parents);
+    }
+
+    // step (1): remove the leaves of N that do not occur in T
+    void remove_foreign_leaves()
+    {
+      for(const Node x: T.leaves())
+        if(T.has_label(x) && T_leaves.try_emplace(T.label(x), x).second) ++num_T_leaves;
+      NodeVec foreign;
+      size_t num_found = 0;
+      for(const Node x: N.leaves()) {
+        if(N.has_label(x) && test(T_leaves, N.label(x))) ++num_found; else foreign.push_back(x);
+      }
+      if(num_found < num_T_leaves) failed = true;
+      DEBUG3(std::cout << "removing "<<foreign.size()<<" leaves that are not in the tree\n");
+      remove_leaves(N, foreign);
+    }
+
+    // return the highest nodes of N that have at least 2 leaves and no reticulation below them
+    //NOTE: we want the subtrees below these nodes to be trees without nodes of out-degree 1, so we don't return reticulations
+    NodeVec get_stable_pendant_roots() const
+    {
+      // count the leaves below each node and check whether there is a reticulation below it
+      HashMap<Node, size_t> num_leaves;
+      HashMap<Node, bool> tree_below;
+      NodeVec candidates;
+      for(const Node x: N.dfs().postorder()) {
+        size_t& x_leaves = num_leaves[x];
+        bool& x_tree_below = tree_below.try_emplace(x, true).first->second;
+        if(N.is_leaf(x)) x_leaves = 1;
+        for(const Node y: N.children(x)) {
+          x_leaves += num_leaves.at(y);
+          x_tree_below &= (N.in_degree(y) == 1) && tree_below.at(y);
         }
+        if(x_tree_below && (x_leaves > 1) && (N.in_degree(x) <= 1)) candidates.push_back(x);
       }
+      // a candidate is highest if its parent has a reticulation below it or is a reticulation (and thus not a candidate)
+      NodeVec result;
+      for(const Node x: candidates)
+        if((N.in_degree(x) == 0) || N.is_reti(N.parent(x)) || !tree_below.at(N.parent(x)))
+          result.push_back(x);
+      return result;
     }
 
-  public:
-    
-    TC_Preprocessor(Network& _N, LSATree& _lsa, ComponentRootInfo& _cr_info):
-      N(_N),
-      lsa(_lsa),
-      cr_info(_cr_info)
+    // return the leaves below x in P and put the nodes below x in postorder into 'order'
+    template<class Phylogeny>
+    static NodeVec leaves_below(const Phylogeny& P, const Node x, NodeVec& order)
     {
-      compute_leaf_stability();
+      NodeVec result;
+      for(const Node y: P.dfs().postorder(x)) {
+        order.push_back(y);
+        if(P.is_leaf(y)) result.push_back(y);
+      }
+      return result;
     }
 
-    void apply()
+    // return whether the subtree of N (given by its nodes in postorder) and the subtree of T below t have the same clusters
+    //NOTE: both subtrees have the same leaf labels and no nodes with out-degree 1, so they are equal if each cluster of T_t is a
+    //      cluster of N_r and they have the same number of inner nodes
+    //NOTE: numbering the leaves of N_r in postorder, each cluster of N_r is an interval, so a cluster of T_t is a cluster of N_r if
+    //      and only if its leaves' numbers form an interval that is the interval of a node of N_r (see Day's algorithm)
+    bool same_clusters(const NodeVec& N_order, const Node t, const NodeVec& T_order) const
     {
-      // step 1: get the component roots in the order of processing
-      std::stack<Node> to_process;
-      for(const auto& cr: cr_info.get_comp_roots_preordered())
-        to_process.push(cr);
-
-      while(!to_process.empty()){
-        std::cout << to_process.top() << " ";
-        to_process.pop();
+      // for each node of N_r, the interval of the numbers of the leaves below it
+      using Interval = std::pair<size_t, size_t>;
+      HashMap<Node, Interval> N_interval;
+      HashSet<uint64_t> N_clusters;
+      size_t N_inner = 0;
+      size_t num_N_leaves = 0;
+      for(const Node x: N_order) {
+        Interval& x_interval = N_interval[x];
+        if(N.is_leaf(x)) {
+          x_interval = {num_N_leaves, num_N_leaves};
+          ++num_N_leaves;
+        } else {
+          ++N_inner;
+          x_interval = {SIZE_MAX, 0};
+          for(const Node y: N.children(x)) {
+            const Interval& y_interval = N_interval.at(y);
+            x_interval.first = std::min(x_interval.first, y_interval.first);
+            x_interval.second = std::max(x_interval.second, y_interval.second);
+          }
+          N_clusters.insert((uint64_t(x_interval.first) << 32) | x_interval.second);
+        }
+      }
+
+      // for each node of T_t, the smallest and largest number of a leaf below it and the number of leaves below it
+      HashMap<Node, std::pair<Interval, size_t>> T_clusters;
+      size_t T_inner = 0;
+      for(const Node u: T_order) {
+        auto& [u_interval, u_leaves] = T_clusters[u];
+        if(T.is_leaf(u)) {
+          const auto N_leaf = N_leaf_of(T.label(u));
+          if(N_leaf == NoNode) return false;
+          u_interval = N_interval.at(N_leaf);
+          u_leaves = 1;
+        } else {
+          ++T_inner;
+          u_interval = {SIZE_MAX, 0};
+          u_leaves = 0;
+          for(const Node v: T.children(u)) {
+            const auto& [v_interval, v_leaves] = T_clusters.at(v);
+            u_interval.first = std::min(u_interval.first, v_interval.first);
+            u_interval.second = std::max(u_interval.second, v_interval.second);
+            u_leaves += v_leaves;
+          }
+          if((u_interval.second - u_interval.first + 1 != u_leaves) ||
+              !test(N_clusters, (uint64_t(u_interval.first) << 32) | u_interval.second)) return false;
+        }
       }
-      std::cout << std::endl;
+      return (T_clusters.at(t).second == num_N_leaves) && (T_inner == N_inner);
+    }
 
-      // step 2: for each component root, check if it is stable on a leaf and, if so,
-#error CONTINUE HERE
+    // the leaf of N below the current pendant root with the given label (NoNode if there is none)
+    HashMap<LabelType, Node> current_N_leaves;
+    Node N_leaf_of(const LabelType& label) const
+    {
+      const auto iter = current_N_leaves.find(label);
+      return (iter != current_N_leaves.end()) ? iter->second : NoNode;
+    }
+
+    // for each of the given roots r of N, find the node t of T whose cluster is the set of labels below r (if any), in a single
+    // bottom-up pass over T: a node of T is "pure" for r if all leaves below it are below r in N, and t is the lowest node that is
+    // pure for r and has as many leaves below it as r
+    //NOTE: reducing the subtree below one root changes T only inside the corresponding subtree of T, so t stays valid for the others
+    HashMap<Node, Node> get_pendant_roots_in_T(const NodeVec& roots) const
+    {
+      HashMap<Node, Node> root_of_leaf; // leaf of T -> root of N above the leaf with the same label
+      HashMap<Node, size_t> num_leaves; // root of N -> number of leaves below it
+      for(const Node r: roots) {
+        size_t& r_leaves = num_leaves[r];
+        for(const Node x: N.dfs().postorder(r))
+          if(N.is_leaf(x)) {
+            root_of_leaf.emplace(T_leaves.at(N.label(x)), r);
+            ++r_leaves;
+          }
+      }
+      HashMap<Node, Node> result;
+      HashMap<Node, std::pair<Node, size_t>> pure; // node of T -> (the root it's pure for or NoNode, number of leaves below it)
+      for(const Node u: T.dfs().postorder()) {
+        auto& [u_root, u_leaves] = pure[u];
+        if(T.is_leaf(u)) {
+          const auto iter = root_of_leaf.find(u);
+          u_root = (iter != root_of_leaf.end()) ? iter->second : NoNode;
+          u_leaves = 1;
+        } else {
+          u_root = pure.at(T.any_child(u)).first;
+          u_leaves = 0;
+          for(const Node v: T.children(u)) {
+            const auto& [v_root, v_leaves] = pure.at(v);
+            if(v_root != u_root) u_root = NoNode;
+            u_leaves += v_leaves;
+          }
+          if((u_root != NoNode) && (u_leaves == num_leaves.at(u_root))) result.try_emplace(u_root, u);
+        }
+      }
+      return result;
+    }
+
+    // step (2) for the stable component rooted at r, whose leaf labels form the cluster of t in T (NoNode if they don't form a cluster):
+    // return 'not_displayed' if T does not contain the subtree of N below r as a pendant subtree, 'displayed' if this subtree is all
+    // of T, and 'unknown' otherwise (after replacing it by a single leaf)
+    Verdict reduce_stable_component(const Node r, const Node t)
+    {
+      if(t == NoNode) {
+        DEBUG3(std::cout << "the leaves below the stable component root "<<r<<" do not form a cluster of the tree\n");
+        return Verdict::not_displayed;
+      }
+      NodeVec N_order;
+      const NodeVec N_leaves = leaves_below(N, r, N_order);
+      current_N_leaves.clear();
+      for(const Node x: N_leaves) current_N_leaves.emplace(N.label(x), x);
+      NodeVec T_order;
+      const NodeVec T_t_leaves = leaves_below(T, t, T_order);
+      if((T_t_leaves.size() != N_leaves.size()) || !same_clusters(N_order, t, T_order)) {
+        DEBUG3(std::cout << "the tree does not contain the pendant subtree below the stable component root "<<r<<"\n");
+        return Verdict::not_displayed;
+      }
+      if(T_t_leaves.size() == num_T_leaves) {
+        DEBUG3(std::cout << "the pendant subtree below the stable component root "<<r<<" is the whole tree\n");
+        return Verdict::displayed;
+      }
+      DEBUG3(std::cout << "replacing the pendant subtree below the stable component root "<<r<<" by the leaf "<<N_leaves.front()<<"\n");
+      // keep the first leaf of the subtree in both N and T
+      const LabelType& kept_label = N.label(N_leaves.front());
+      NodeVec T_removed;
+      for(const Node x: T_t_leaves)
+        if(T.label(x) != kept_label) {
+          T_removed.push_back(x);
+          T_leaves.erase(T.label(x));
+        }
+      num_T_leaves -= T_removed.size();
+      remove_leaves(T, T_removed);
+      remove_leaves(N, NodeVec(std::next(N_leaves.begin()), N_leaves.end()));
+      ++stats.components_reduced;
+      return Verdict::unknown;
+    }
+
+  public:
+
+    TC_Preprocessor(Network& _N, Tree& _T):
+      N(_N),
+      T(_T)
+    {}
+
+    const TC_PreprocessStats& get_stats() const { return stats; }
+
+    // shrink N and T; return 'displayed' or 'not_displayed' if this decided the instance, and 'unknown' otherwise
+    Verdict apply()
+    {
+      const size_t N_nodes = N.num_nodes();
+      const size_t N_edges = N.num_edges();
+      const size_t T_nodes = T.num_nodes();
+      const size_t T_edges = T.num_edges();
+
+      Verdict result = Verdict::unknown;
+      remove_foreign_leaves();
+      if(failed) {
+        DEBUG3(std::cout << "some leaf of the tree is not in the network\n");
+        result = Verdict::not_displayed;
+      } else {
+        // step 1: get the roots of the highest subtrees without reticulations
+        const NodeVec roots = get_stable_pendant_roots();
+        const HashMap<Node, Node> roots_in_T = get_pendant_roots_in_T(roots);
+        // step 2: replace each of them by a leaf
+        //NOTE: the subtrees below the roots are disjoint, but cleaning up N after reducing one of them might suppress the node above
+        //      another; its subtree is still pendant in all displayed trees then, so we can still reduce it
+        for(const Node r: roots) {
+          if(!N.has_node(r)) continue;
+          const auto t_iter = roots_in_T.find(r);
+          result = reduce_stable_component(r, (t_iter != roots_in_T.end()) ? t_iter->second : NoNode);
+          if(result != Verdict::unknown) break;
+        }
+      }
+
+      stats.host_nodes_removed = N_nodes - N.num_nodes();
+      stats.host_edges_removed = N_edges - N.num_edges();
+      stats.guest_nodes_removed = T_nodes - T.num_nodes();
+      stats.guest_edges_removed = T_edges - T.num_edges();
+      return result;
     }
   };
 }
-
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <utility>
+#include <condition_variable>
+#include "utils.hpp"
+
+namespace PT{
+
+  // a thread-pool in which each worker has its own task-deque: workers take work from the back of their own deque and,
+  // when that runs dry, steal from the front of the others' deques
+  //NOTE: tasks submitted by threads that are not workers of this pool go into an extra "inbox" deque that everyone steals from
+  class WorkStealingPool
+  {
+  public:
+    using Task = std::function<void()>;
+
+  protected:
+    struct TaskDeque
+    {
+      std::mutex lock;
+      std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskDeque>> deques; // one deque per worker + the inbox
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> num_queued = 0;
+    std::atomic<bool> stopping = false;
+    std::mutex sleep_lock;
+    std::condition_variable wake_up;
+
+    // each thread knows which pool it's working for and the index of its deque in that pool
+    static inline thread_local const WorkStealingPool* my_pool = nullptr;
+    static inline thread_local size_t my_index = 0;
+
+    size_t inbox_index() const { return workers.size(); }
+    size_t own_index() const { return (my_pool == this) ? my_index : inbox_index(); }
+
+    bool pop_back(const size_t index, Task& task)
+    {
+      TaskDeque& d = *deques[index];
+      const std::lock_guard<std::mutex> guard(d.lock);
+      if(d.tasks.empty()) return false;
+      task = std::move(d.tasks.back());
+      d.tasks.pop_back();
+      return true;
+    }
+
+    bool steal_front(const size_t index, Task& task)
+    {
+      TaskDeque& d = *deques[index];
+      const std::lock_guard<std::mutex> guard(d.lock);
+      if(d.tasks.empty()) return false;
+      task = std::move(d.tasks.front());
+      d.tasks.pop_front();
+      return true;
+    }
+
+    void work(const size_t index)
+    {
+      my_pool = this;
+      my_index = index;
+      while(!stopping) {
+        if(!run_pending_task()) {
+          std::unique_lock<std::mutex> guard(sleep_lock);
+          wake_up.wait(guard, [this]{ return stopping || (num_queued > 0); });
+        }
+      }
+    }
+
+  public:
+
+    // construct a pool with the given number of worker threads
+    //NOTE: threads that wait for a TaskGroup also run tasks while waiting, so the pool may be one smaller than the desired parallelism
+    WorkStealingPool(const size_t num_workers)
+    {
+      for(size_t i = 0; i <= num_workers; ++i)
+        deques.emplace_back(std::make_unique<TaskDeque>());
+      workers.reserve(num_workers);
+      for(size_t i = 0; i < num_workers; ++i)
+        workers.emplace_back(&WorkStealingPool::work, this, i);
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+      {
+        const std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+      }
+      wake_up.notify_all();
+      for(auto& t: workers) t.join();
+    }
+
+    size_t num_workers() const { return workers.size(); }
+
+    void submit(Task task)
+    {
+      TaskDeque& d = *deques[own_index()];
+      {
+        const std::lock_guard<std::mutex> guard(d.lock);
+        d.tasks.push_back(std::move(task));
+      }
+      {
+        const std::lock_guard<std::mutex> guard(sleep_lock);
+        ++num_queued;
+      }
+      wake_up.notify_one();
+    }
+
+    // run a single task: prefer our own deque, then steal from the others (starting with our right neighbor)
+    // return whether we found a task to run
+    bool run_pending_task()
+    {
+      if(num_queued == 0) return false;
+      const size_t own = own_index();
+      Task task;
+      bool found = pop_back(own, task);
+      for(size_t i = 1; !found && (i < deques.size()); ++i)
+        found = steal_front((own + i) % deques.size(), task);
+      if(!found) return false;
+      --num_queued;
+      task();
+      return true;
+    }
+  };
+
+  // a group of tasks that can be waited for; waiting threads help out by running pending tasks of the pool
+  class TaskGroup
+  {
+    WorkStealingPool& pool;
+    std::atomic<size_t> pending = 0;
+    std::mutex error_lock;
+    std::exception_ptr error; // the first exception thrown by one of our tasks (rethrown by wait())
+
+  public:
+    TaskGroup(WorkStealingPool& _pool): pool(_pool) {}
+    TaskGroup(const TaskGroup&) = delete;
+    ~TaskGroup() { while(pending > 0) if(!pool.run_pending_task()) std::this_thread::yield(); }
+
+    template<class Function>
+    void run(Function&& f)
+    {
+      ++pending;
+      pool.submit([this, f = std::forward<Function>(f)]() mutable {
+          try { f(); } catch(...) {
+            const std::lock_guard<std::mutex> guard(error_lock);
+            if(!error) error = std::current_exception();
+          }
+          --pending;
+        });
+    }
+
+    void wait()
+    {
+      while(pending > 0)
+        if(!pool.run_pending_task()) std::this_thread::yield();
+      if(error) std::rethrow_exception(std::exchange(error, nullptr));
+    }
+  };
+
+}
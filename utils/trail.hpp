@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include "utils.hpp"
+
+/*
+ * an undo-trail allows modifying mutable structures in-place and rolling back all modifications made since a checkpoint
+ * (f.ex. when a branch of a search failed) without copying the structures at each checkpoint.
+ * Each structure keeps a TrailLog of the information needed to undo its own modifications and registers with the UndoTrail
+ * each time it logs something, so the trail knows in which order to undo them.
+ */
+
+namespace PT{
+
+  // something whose most recent (logged) modification can be undone
+  struct Undoable
+  {
+    virtual void undo_last() = 0;
+    virtual ~Undoable() = default;
+  };
+
+  class UndoTrail
+  {
+    std::vector<Undoable*> modified;
+    // for each checkpoint, remember the size of 'modified' and a unique ID
+    std::vector<std::pair<size_t, size_t>> checkpoints;
+    size_t next_checkpoint_id = 1;
+
+  public:
+    bool recording() const { return !checkpoints.empty(); }
+    size_t depth() const { return checkpoints.size(); }
+    size_t size() const { return modified.size(); }
+    // the ID of the current checkpoint (0 if we're not recording)
+    size_t checkpoint_id() const { return recording() ? checkpoints.back().second : 0; }
+
+    void record(Undoable& u) { modified.push_back(&u); }
+
+    void checkpoint() { checkpoints.emplace_back(modified.size(), next_checkpoint_id++); }
+
+    // undo all modifications since the last checkpoint and remove it
+    void rollback()
+    {
+      assert(recording());
+      const size_t mark = checkpoints.back().first;
+      checkpoints.pop_back();
+      while(modified.size() > mark){
+        modified.back()->undo_last();
+        modified.pop_back();
+      }
+    }
+  };
+
+  // a log of Entries for an Owner: undoing hands the last entry back to the owner (via owner.restore_from_trail(entry))
+  template<class Owner, class Entry>
+  class TrailLog: public Undoable
+  {
+    Owner& owner;
+    UndoTrail& trail;
+    std::vector<Entry> entries;
+  public:
+    TrailLog(Owner& _owner, UndoTrail& _trail): owner(_owner), trail(_trail) {}
+
+    UndoTrail& get_trail() const { return trail; }
+    bool recording() const { return trail.recording(); }
+
+    // save an entry (if the trail is recording)
+    template<class... Args>
+    void save(Args&&... args)
+    {
+      if(trail.recording()){
+        entries.emplace_back(std::forward<Args>(args)...);
+        trail.record(*this);
+      }
+    }
+
+    void undo_last() override
+    {
+      assert(!entries.empty());
+      owner.restore_from_trail(std::move(entries.back()));
+      entries.pop_back();
+    }
+  };
+
+  // a log is bound to its owner, so copying (or moving) the owner should not copy the log; this holder takes care of that
+  template<class Log>
+  class TrailLogHolder: public std::unique_ptr<Log>
+  {
+    using Parent = std::unique_ptr<Log>;
+  public:
+    TrailLogHolder() = default;
+    TrailLogHolder(const TrailLogHolder&): Parent() {}
+    TrailLogHolder(TrailLogHolder&&): Parent() {}
+    TrailLogHolder& operator=(const TrailLogHolder&) { Parent::reset(); return *this; }
+    TrailLogHolder& operator=(TrailLogHolder&&) { Parent::reset(); return *this; }
+
+    // bind a new log to the given owner and trail (or unbind the log if no trail is given)
+    template<class Owner>
+    void bind(Owner& owner, UndoTrail* trail)
+    {
+      if(trail) Parent::reset(new Log(owner, *trail)); else Parent::reset();
+    }
+  };
+
+}
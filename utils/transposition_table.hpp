@@ -0,0 +1,176 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include "utils.hpp"
+#include "types.hpp"
+
+/*
+ * a transposition table remembers results of sub-instances that have already been decided during a search,
+ * so that sub-instances that are reached via different branching orders are not solved again from scratch.
+ * Instances are identified by 128-bit structural fingerprints, which do not depend on node indices or on the order of children.
+ * Like all transposition tables, we assume that two different instances never have the same fingerprint.
+ */
+
+namespace PT{
+
+  using Fingerprint = std::pair<uint64_t, uint64_t>;
+
+  struct FingerprintHash
+  {
+    size_t operator()(const Fingerprint& fp) const { return hash_combine(fp.first, fp.second); }
+  };
+
+  // combine a fingerprint with the fingerprint of something else
+  inline Fingerprint& operator+=(Fingerprint& fp, const Fingerprint& other)
+  {
+    fp.first = uint64_hash(fp.first ^ uint64_hash(other.first + 0x9e3779b97f4a7c15ULL));
+    fp.second = uint64_hash(fp.second + uint64_hash(other.second ^ 0xc2b2ae3d27d4eb4fULL));
+    return fp;
+  }
+
+  // a fingerprint of a (rooted, directed acyclic) network that is independent of node indices and the order of children
+  // each node gets a signature computed from below (its label, in-degree and the signatures of its children) and
+  // one computed from above (its signature from below and the signatures of its parents), the fingerprint combines all of them
+  //NOTE: we use two independent hashes for the two halves of the fingerprint
+  template<class Network>
+  Fingerprint structural_fingerprint(const Network& N, const bool leaf_labels_only = true)
+  {
+    if(N.empty()) return {0, 0};
+    HashMap<Node, Fingerprint> below;
+    HashMap<Node, Fingerprint> above;
+    const std::hash<std::remove_cvref_t<typename Network::LabelType>> label_hash;
+
+    NodeVec order;
+    for(const Node v: N.dfs().postorder()) {
+      order.push_back(v);
+      Fingerprint v_sig = {N.in_degree(v) + 1, N.in_degree(v) + 2};
+      if(!leaf_labels_only || N.is_leaf(v)) {
+        const size_t lh = label_hash(N.label(v));
+        v_sig.first ^= uint64_hash(lh);
+        v_sig.second ^= uint64_hash(lh + 1);
+      }
+      // to be independent of the order of children, we just sum the (hashed) signatures of the children
+      Fingerprint children_sig = {0, 0};
+      for(const Node c: N.children(v)){
+        const Fingerprint& c_sig = below.at(c);
+        children_sig.first += uint64_hash(c_sig.first);
+        children_sig.second += uint64_hash(c_sig.second ^ 0x5bd1e995);
+      }
+      v_sig += children_sig;
+      below.emplace(v, v_sig);
+    }
+    // the reverse postorder is a topological order, so all parents of v have been treated when we treat v
+    Fingerprint result = {N.num_nodes(), N.num_edges()};
+    for(auto v_iter = order.rbegin(); v_iter != order.rend(); ++v_iter){
+      const Node v = *v_iter;
+      Fingerprint parents_sig = {0, 0};
+      for(const Node p: N.parents(v)){
+        const Fingerprint& p_sig = above.at(p);
+        parents_sig.first += uint64_hash(p_sig.first);
+        parents_sig.second += uint64_hash(p_sig.second ^ 0x27d4eb2d);
+      }
+      Fingerprint v_sig = below.at(v);
+      v_sig += parents_sig;
+      above.emplace(v, v_sig);
+      // the sum over all nodes is, again, independent of the order
+      result.first += uint64_hash(v_sig.first);
+      result.second += uint64_hash(v_sig.second ^ 0x165667b1);
+    }
+    return result;
+  }
+
+
+  // a bounded map of fingerprints to values; when full, the least recently used entry is evicted
+  //NOTE: this is thread-safe, so parallel searches can share a table
+  template<class Value>
+  class TranspositionTable
+  {
+    using Entry = std::pair<Fingerprint, Value>;
+    using EntryList = std::list<Entry>;
+
+    const size_t capacity;
+    EntryList entries; // most recently used entries are at the front
+    HashMap<Fingerprint, typename EntryList::iterator, FingerprintHash> index;
+    mutable std::mutex lock;
+
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+
+  public:
+    TranspositionTable(const size_t _capacity): capacity(_capacity) {}
+
+    // look up the value of the instance with the given fingerprint and copy it into 'value'; return whether we found it
+    bool lookup(const Fingerprint& fp, Value& value)
+    {
+      const std::lock_guard<std::mutex> guard(lock);
+      const auto iter = index.find(fp);
+      if(iter != index.end()){
+        ++hits;
+        entries.splice(entries.begin(), entries, iter->second);
+        value = iter->second->second;
+        return true;
+      } else {
+        ++misses;
+        return false;
+      }
+    }
+
+    void insert(const Fingerprint& fp, const Value& value)
+    {
+      if(capacity == 0) return;
+      const std::lock_guard<std::mutex> guard(lock);
+      const auto [iter, success] = index.try_emplace(fp);
+      if(success){
+        if(entries.size() == capacity) {
+          index.erase(entries.back().first);
+          entries.pop_back();
+          ++evictions;
+        }
+        entries.emplace_front(fp, value);
+        iter->second = entries.begin();
+      } else {
+        iter->second->second = value;
+        entries.splice(entries.begin(), entries, iter->second);
+      }
+    }
+
+    // insert the fingerprint with the given value unless it is already in the table; return whether it was new
+    //NOTE: unlike a lookup() followed by an insert(), this is atomic, so exactly one of several threads inserting fp gets 'true'
+    bool insert_new(const Fingerprint& fp, const Value& value)
+    {
+      if(capacity == 0) return true;
+      const std::lock_guard<std::mutex> guard(lock);
+      const auto [iter, success] = index.try_emplace(fp);
+      if(success){
+        ++misses;
+        if(entries.size() == capacity) {
+          index.erase(entries.back().first);
+          entries.pop_back();
+          ++evictions;
+        }
+        entries.emplace_front(fp, value);
+        iter->second = entries.begin();
+      } else {
+        ++hits;
+        entries.splice(entries.begin(), entries, iter->second);
+      }
+      return success;
+    }
+
+    size_t size() const { const std::lock_guard<std::mutex> guard(lock); return entries.size(); }
+    size_t get_capacity() const { return capacity; }
+    size_t num_hits() const { const std::lock_guard<std::mutex> guard(lock); return hits; }
+    size_t num_misses() const { const std::lock_guard<std::mutex> guard(lock); return misses; }
+    size_t num_evictions() const { const std::lock_guard<std::mutex> guard(lock); return evictions; }
+
+    friend std::ostream& operator<<(std::ostream& os, const TranspositionTable& tt)
+    {
+      const std::lock_guard<std::mutex> guard(tt.lock);
+      return os << tt.entries.size() << "/" << tt.capacity << " entries, "
+                << tt.hits << " hits, " << tt.misses << " misses, " << tt.evictions << " evictions";
+    }
+  };
+
+}
@@ -32,7 +32,8 @@ namespace PT{
   {
     const __Tree& t;
     NodeTypePredicate(const __Tree& _t): t(_t) {}
-    bool value(const Node x) const { return t.type_of(x) == nt; }
+    //NOTE: some label maps (raw_vector_map) keep entries for removed nodes, so we have to check that x is still there
+    bool value(const Node x) const { return t.has_node(x) && (t.type_of(x) == nt); }
   };
   template<class __Tree>
   using LeafPredicate = NodeTypePredicate<__Tree, NODE_TYPE_LEAF>;
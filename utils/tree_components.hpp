@@ -148,6 +148,16 @@ namespace PT{
     {}
 
 
+    // return whether each tree component (except the root component) is visible from a leaf
+    //NOTE: this is the case for tree-child networks, for example, since each tree component contains a leaf then
+    //NOTE: in such networks, each lowest tree component is eligible for the visible-component rule, so containment can be decided without branching
+    bool all_components_visible() const
+    {
+      for(const Node rt: comp_DAG.nodes())
+        if((rt != comp_DAG.root()) && (N[rt].visible_leaf == NoNode)) return false;
+      return true;
+    }
+
     // get the highest component-root that is visible on u
     Node get_highest_visible_comp_root(const Node u){
       // get highest initial component root reachable without reticulation
@@ -220,6 +230,81 @@ namespace PT{
       } else return false;
     }
 
+    // recompute the component infos in and directly below the tree components rooted at the given nodes (after N has been modified near
+    // them): the component roots of their nodes, the reticulation chains below them, their visible leaves, and the components seen
+    // by the reticulation parents of the component roots below these chains; 'above' maps each non-trivial component root to the
+    // components seen by its reticulation parents, we update it for all these roots and rebuild the component DAG from it
+    // return false (without changing anything) if this would visit more than max_nodes nodes
+    //NOTE: each given node must be the root of N or have a reticulation parent, and each component whose infos may have changed must be given
+    template<class AboveMap>
+    bool update_components(const NodeVec& roots, AboveMap& above, const size_t max_nodes)
+    {
+      // first, collect the nodes of the components (with their roots), the reticulations below them, and the roots below the reticulations
+      std::vector<std::pair<Node, Node>> members;
+      NodeVec retis;
+      NodeVec trivial_roots;
+      NodeVec non_trivial_roots;
+      typename Network::NodeSet seen;
+      NodeVec todo;
+      NodeVec inner_roots;
+      for(const Node rt: roots)
+        if(seen.emplace(rt).second) {
+          if(N.is_leaf(rt)) {
+            trivial_roots.push_back(rt);
+          } else {
+            inner_roots.push_back(rt);
+            if(rt != N.root()) non_trivial_roots.push_back(rt);
+          }
+        }
+      for(const Node rt: inner_roots) {
+        todo.push_back(rt);
+        while(!todo.empty()) {
+          const Node x = value_pop_back(todo);
+          if(members.size() + retis.size() > max_nodes) return false;
+          if(N.is_reti(x)) {
+            retis.push_back(x);
+          } else members.emplace_back(x, rt);
+          for(const Node y: N.children(x)) {
+            if(!N.is_reti(x) && !N.is_reti(y)) {
+              if(N.is_leaf(y)) {
+                if(seen.emplace(y).second) trivial_roots.push_back(y);
+              } else todo.push_back(y);
+            } else if(seen.emplace(y).second) {
+              // y is on a reticulation chain below the component or it's the first node below such a chain
+              if(N.is_reti(y)) todo.push_back(y);
+              else if(N.is_leaf(y)) trivial_roots.push_back(y);
+              else non_trivial_roots.push_back(y);
+            }
+          }
+        }
+      }
+      DEBUG3(std::cout << "updating component infos of "<<members.size()<<" nodes and "<<retis.size()<<" reticulations below "<<roots<<"\n");
+
+      // second, recompute everything as in compute_comp_DAG()
+      for(const Node r: retis) N[r].clear();
+      for(const auto& [x, rt]: members) {
+        N[x].comp_root = rt;
+        N[x].visible_leaf = NoNode;
+        if(x != rt) above.erase(x);
+      }
+      for(const Node u: non_trivial_roots) {
+        typename Network::NodeSet components_above;
+        update_reticulations(u, &components_above);
+        if(!components_above.empty())
+          above[u].assign(components_above.begin(), components_above.end());
+        else above.erase(u);
+      }
+      for(const Node u: trivial_roots) {
+        const Node rt = update_reticulations(u);
+        if(rt != NoNode) N[rt].visible_leaf = u;
+      }
+      EdgeVec edges;
+      for(const auto& [u, u_above]: above)
+        for(const Node v: u_above) edges.emplace_back(v, u);
+      comp_DAG = RWNetwork<>(std::move(edges));
+      return true;
+    }
+
     // return the intersection of component roots of nodes in the container c (or NoNode if the intersection is empty)
     template<class Container>
     Node comp_root_consensus(const Container& c)
@@ -150,6 +150,14 @@ namespace std{
 
     bool is_root(const T& x) const { return *(at(x).representative) == x; }
 
+    // return the set containing x without path compression (so this can be used on const forests)
+    const DSet<T>& peek_set_of(const T& x) const
+    {
+      const T* r = &x;
+      while(*(at(*r).representative) != *r) r = at(*r).representative;
+      return at(*r);
+    }
+
     // return true iff the given items are in the same set
     bool in_same_set(const T& x, const T& y)
     {
@@ -174,26 +182,27 @@ namespace std{
 
     DisjointSetForest(): Parent() {}
     DisjointSetForest(const DisjointSetForest& _dsf):
-      Parent(_dsf)
+      Parent(_dsf), _set_count(_dsf._set_count)
     {
       fix_pointers();
     }
-    // for moving, the unordered_map move-constructor should be fine
-    DisjointSetForest(DisjointSetForest&& _dsf):
-      Parent(_dsf), _set_count(std::move(_dsf._set_count))
+    // for moving, the unordered_map move-constructor should be fine (it keeps the nodes, so the representatives stay valid)
+    DisjointSetForest(DisjointSetForest&& _dsf) noexcept:
+      Parent(std::move(_dsf)), _set_count(_dsf._set_count)
     {}
 
     DisjointSetForest& operator=(const DisjointSetForest& _dsf)
     {
       Parent::operator=(_dsf);
+      _set_count = _dsf._set_count;
       fix_pointers();
       return *this;
     }
-    // for moving, the unordered_map move-constructor should be fine
-    DisjointSetForest& operator=(DisjointSetForest&& _dsf)
+    // for moving, the unordered_map move-assignment should be fine
+    DisjointSetForest& operator=(DisjointSetForest&& _dsf) noexcept
     {
-      Parent::operator=(_dsf);
-      fix_pointers();
+      Parent::operator=(std::move(_dsf));
+      _set_count = _dsf._set_count;
       return *this;
     }
 
@@ -57,7 +57,7 @@ namespace std{
 	  insert_result try_emplace(const key_type key, Args&&... args)
     {
       if(key >= size()) {
-        Parent::reserve(key + 1);
+        Parent::reserve_index(key);
         resize(key);
         Parent::emplace_back(forward<Args>(args)...);
       } else if(!contains(key)){
@@ -118,8 +118,7 @@ namespace std{
 
     bool contains(const key_type key) const
     {
-      assert(key < size());
-      return !StaticEqualPredicate<_Element, InvalidElement>::value(*(data() + key));
+      return (key < size()) && !StaticEqualPredicate<_Element, InvalidElement>::value(*(data() + key));
     }
   };
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "utils.hpp"
+#include "types.hpp"
+
+namespace PT{
+
+  // a stack of nodes that contains each node at most once (pushing a node that is already in the list does nothing)
+  //NOTE: the nodes in the list are marked in a bitset indexed by the nodes, so this is meant for (reasonably) small node indices
+  class NodeWorklist
+  {
+    NodeVec nodes;
+    std::vector<bool> in_list;
+
+  public:
+    // return whether x was new to the list
+    bool push(const Node x)
+    {
+      if(x >= in_list.size()) in_list.resize(std::max(x + 1, 2 * in_list.size()));
+      if(in_list[x]) return false;
+      in_list[x] = true;
+      nodes.push_back(x);
+      return true;
+    }
+
+    Node pop()
+    {
+      assert(!nodes.empty());
+      const Node x = nodes.back();
+      nodes.pop_back();
+      in_list[x] = false;
+      return x;
+    }
+
+    bool contains(const Node x) const { return (x < in_list.size()) && in_list[x]; }
+    bool empty() const { return nodes.empty(); }
+    size_t size() const { return nodes.size(); }
+
+    void clear()
+    {
+      for(const Node x: nodes) in_list[x] = false;
+      nodes.clear();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const NodeWorklist& wl) { return os << wl.nodes; }
+  };
+
+  // someone who wants to be told which nodes of a mutable storage are modified
+  struct ModificationListener
+  {
+    // this is called right before the adjacencies of x are modified (or x is created or removed)
+    virtual void modifying(const Node x) = 0;
+    virtual ~ModificationListener() = default;
+  };
+
+  // a pointer to a listener that is not copied or moved along with the object holding it
+  //NOTE: whoever listens to the modifications of a storage is not interested in the modifications of its copies
+  class ListenerHolder
+  {
+    ModificationListener* listener = nullptr;
+  public:
+    ListenerHolder() = default;
+    ListenerHolder(const ListenerHolder&) {}
+    ListenerHolder(ListenerHolder&&) {}
+    ListenerHolder& operator=(const ListenerHolder&) { listener = nullptr; return *this; }
+    ListenerHolder& operator=(ListenerHolder&&) { listener = nullptr; return *this; }
+
+    void bind(ModificationListener* _listener) { listener = _listener; }
+    operator bool() const { return listener != nullptr; }
+    ModificationListener* operator->() const { return listener; }
+  };
+
+}